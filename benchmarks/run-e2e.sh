@@ -0,0 +1,190 @@
+#!/bin/sh
+#
+# Runs cutefish-statusbar against scripted stand-in services on a private
+# session bus, and on Xvfb unless PLATFORM=offscreen, then prints the
+# measurements of statusbar_fakepeers as JSON.
+#
+# Usage: benchmarks/run-e2e.sh [statusbar_fakepeers options]
+#   e.g. benchmarks/run-e2e.sh --items 30 --update-rate 2 --menu-size 50 --idle 120
+#
+#        benchmarks/run-e2e.sh --replay capture.pcap [statusbar_replay options]
+#   plays a capture recorded with CUTEFISH_STATUSBAR_RECORD=capture.pcap
+#   instead, e.g. with --speed 10.
+#
+#        benchmarks/run-e2e.sh --startup [runs]
+#   starts the bar runs times (default 10) without peers and prints the
+#   median of every startup profiler stage and of the resident memory.
+#
+# BUILD_DIR   build tree configured with -DBUILD_BENCHMARKS=ON (default: build)
+# PLATFORM    xcb or offscreen (default: xcb)
+# SCREEN      Xvfb screen geometry (default: 1920x1080x24)
+
+set -eu
+
+BUILD_DIR=${BUILD_DIR:-build}
+PLATFORM=${PLATFORM:-xcb}
+SCREEN=${SCREEN:-1920x1080x24}
+
+PEERS=statusbar_fakepeers
+RUNS=0
+if [ "${1:-}" = --replay ]; then
+    shift
+    PEERS=statusbar_replay
+elif [ "${1:-}" = --startup ]; then
+    RUNS=${2:-10}
+    PEERS=
+fi
+
+for binary in cutefish-statusbar $PEERS; do
+    if [ ! -x "$BUILD_DIR/$binary" ]; then
+        echo "$BUILD_DIR/$binary not found, configure with -DBUILD_BENCHMARKS=ON and build first" >&2
+        exit 1
+    fi
+done
+
+WORK_DIR=$(mktemp -d)
+DBUS_PID=
+XVFB_PID=
+STATUSBAR_PID=
+REPLAY_PID=
+
+cleanup() {
+    for pid in $STATUSBAR_PID $REPLAY_PID $XVFB_PID $DBUS_PID; do
+        kill "$pid" 2>/dev/null || true
+    done
+    rm -rf "$WORK_DIR"
+}
+trap cleanup EXIT INT TERM
+
+# Settings and caches stay out of the user's home.
+export HOME="$WORK_DIR/home"
+export XDG_CONFIG_HOME="$HOME/.config"
+export XDG_CACHE_HOME="$HOME/.cache"
+mkdir -p "$XDG_CONFIG_HOME" "$XDG_CACHE_HOME"
+
+dbus-daemon --session --fork --print-address=3 --print-pid=4 \
+    3>"$WORK_DIR/dbus-address" 4>"$WORK_DIR/dbus-pid"
+DBUS_PID=$(cat "$WORK_DIR/dbus-pid")
+DBUS_SESSION_BUS_ADDRESS=$(cat "$WORK_DIR/dbus-address")
+export DBUS_SESSION_BUS_ADDRESS
+
+if [ "$PLATFORM" = xcb ]; then
+    display=99
+    while [ -e "/tmp/.X11-unix/X$display" ] || [ -e "/tmp/.X$display-lock" ]; do
+        display=$((display + 1))
+    done
+
+    Xvfb ":$display" -screen 0 "$SCREEN" -nolisten tcp >"$WORK_DIR/xvfb.log" 2>&1 &
+    XVFB_PID=$!
+    export DISPLAY=":$display"
+
+    tries=0
+    until [ -e "/tmp/.X11-unix/X$display" ]; do
+        tries=$((tries + 1))
+        if [ $tries -gt 50 ]; then
+            echo "Xvfb did not start:" >&2
+            cat "$WORK_DIR/xvfb.log" >&2
+            exit 1
+        fi
+        sleep 0.1
+    done
+fi
+
+export QT_QPA_PLATFORM="$PLATFORM"
+export QML_IMPORT_PATH="$BUILD_DIR${QML_IMPORT_PATH:+:$QML_IMPORT_PATH}"
+
+# Prints the median of each stage over all logs as JSON. Breakdown lines
+# look like "  qml                              +85 ms (140 ms)".
+startup_summary() {
+    awk '
+        /startup breakdown/ { run++; next }
+        /^  resident memory / { rss[run] = $3; next }
+        /^  .* \+[0-9]+ ms \([0-9]+ ms\)$/ {
+            line = substr($0, 3)
+            at = match(line, / +\+[0-9]+ ms/)
+            name = substr(line, 1, at - 1)
+            split(substr(line, at), parts, /[+ ]+/)
+            if (!(name in count)) order[++stages] = name
+            values[name, ++count[name]] = parts[2]
+        }
+        function median(list, n,    i, j, t) {
+            for (i = 2; i <= n; i++)
+                for (j = i; j > 1 && list[j - 1] > list[j]; j--) {
+                    t = list[j]; list[j] = list[j - 1]; list[j - 1] = t
+                }
+            return n % 2 ? list[(n + 1) / 2] : (list[n / 2] + list[n / 2 + 1]) / 2
+        }
+        END {
+            printf "{\n  \"runs\": %d,\n  \"stagesMs\": {", run
+            for (s = 1; s <= stages; s++) {
+                name = order[s]
+                delete list
+                for (i = 1; i <= count[name]; i++) list[i] = values[name, i] + 0
+                printf "%s\n    \"%s\": %s", (s > 1 ? "," : ""), name, median(list, count[name])
+            }
+            delete list
+            n = 0
+            for (r in rss) list[++n] = rss[r] + 0
+            printf "\n  },\n  \"residentMemoryKiB\": %s\n}\n", n ? median(list, n) : -1
+        }
+    ' "$@"
+}
+
+if [ "$RUNS" -gt 0 ]; then
+    run=1
+    while [ $run -le "$RUNS" ]; do
+        log="$WORK_DIR/startup-$run.log"
+        CUTEFISH_STATUSBAR_STARTUP_PROFILE=1 "$BUILD_DIR/cutefish-statusbar" >"$log" 2>&1 &
+        STATUSBAR_PID=$!
+
+        # The breakdown is printed a few seconds after the first frame.
+        tries=0
+        until grep -q "resident memory" "$log"; do
+            tries=$((tries + 1))
+            if [ $tries -gt 300 ] || ! kill -0 $STATUSBAR_PID 2>/dev/null; then
+                echo "No startup breakdown from run $run:" >&2
+                cat "$log" >&2
+                exit 1
+            fi
+            sleep 0.1
+        done
+
+        kill $STATUSBAR_PID 2>/dev/null || true
+        wait $STATUSBAR_PID 2>/dev/null || true
+        STATUSBAR_PID=
+        run=$((run + 1))
+    done
+
+    startup_summary "$WORK_DIR"/startup-*.log
+    exit 0
+fi
+
+if [ $PEERS = statusbar_replay ]; then
+    # The recorded peers have to own their names before the bar starts.
+    "$BUILD_DIR/statusbar_replay" --ready-file "$WORK_DIR/ready" "$@" &
+    REPLAY_PID=$!
+
+    until [ -e "$WORK_DIR/ready" ]; do
+        if ! kill -0 $REPLAY_PID 2>/dev/null; then
+            wait $REPLAY_PID || true
+            exit 1
+        fi
+        sleep 0.1
+    done
+fi
+
+CUTEFISH_STATUSBAR_HARNESS=1 "$BUILD_DIR/cutefish-statusbar" >"$WORK_DIR/statusbar.log" 2>&1 &
+STATUSBAR_PID=$!
+
+if [ $PEERS = statusbar_replay ]; then
+    wait $REPLAY_PID && status=0 || status=$?
+    REPLAY_PID=
+else
+    "$BUILD_DIR/statusbar_fakepeers" "$@" && status=0 || status=$?
+fi
+
+if [ $status -ne 0 ]; then
+    echo "$PEERS failed, statusbar output:" >&2
+    cat "$WORK_DIR/statusbar.log" >&2
+    exit 1
+fi
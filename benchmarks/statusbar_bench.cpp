@@ -0,0 +1,608 @@
+/*
+ * Copyright (C) 2021 CutefishOS Team.
+ *
+ * Author:     cutefishos <cutefishos@foxmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "capplications.h"
+#include "backgroundhelper.h"
+#include "startupprofiler.h"
+#include "systemtray/systemtraymodel.h"
+#include "systemtray/statusnotifieritemsource.h"
+#include "libdbusmenuqt/dbusmenuimporter.h"
+#include "libdbusmenuqt/dbusmenutypes_p.h"
+
+#include <QtTest>
+#include <QApplication>
+#include <QDBusConnection>
+#include <QDBusMessage>
+#include <QDBusPendingCallWatcher>
+#include <QDBusServer>
+#include <QDBusVirtualObject>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMenu>
+#include <QPainter>
+#include <QRandomGenerator>
+#include <QTemporaryDir>
+#include <QTemporaryFile>
+#include <QXmlStreamReader>
+
+#include <utility>
+
+static const int s_corpusSize = 500;
+static const int s_wideMenus = 20;
+static const int s_wideMenuItems = 500;
+static const char *s_menuPath = "/MenuBar";
+
+// Answers GetLayout on a private peer connection, so layouts arrive
+// marshalled exactly as a real application sends them.
+class LayoutPeer : public QDBusVirtualObject
+{
+public:
+    QString introspect(const QString &) const override
+    {
+        return QString();
+    }
+
+    bool handleMessage(const QDBusMessage &message, const QDBusConnection &connection) override
+    {
+        QDBusMessage reply = message.createReply();
+        reply << uint(1) << QVariant::fromValue(layout);
+        return connection.send(reply);
+    }
+
+    DBusMenuLayoutItem layout;
+};
+
+static DBusMenuLayoutItem syntheticLayout(int items)
+{
+    DBusMenuLayoutItem root;
+    root.id = 0;
+
+    for (int i = 1; i <= items; ++i) {
+        DBusMenuLayoutItem item;
+        item.id = i;
+        item.properties.insert("label", QString("Item _%1").arg(i));
+        item.properties.insert("icon-name", "document-open");
+        item.properties.insert("enabled", i % 7 != 0);
+        item.properties.insert("visible", true);
+
+        // Every tenth item opens a small submenu.
+        if (i % 10 == 0) {
+            item.properties.insert("children-display", "submenu");
+            for (int j = 0; j < 5; ++j) {
+                DBusMenuLayoutItem child;
+                child.id = items + i * 5 + j;
+                child.properties.insert("label", QString("Child %1").arg(j));
+                item.children.append(child);
+            }
+        }
+
+        root.children.append(item);
+    }
+
+    return root;
+}
+
+static QImage syntheticWallpaper(const QSize &size)
+{
+    QImage image(size, QImage::Format_RGB32);
+    QPainter painter(&image);
+
+    QLinearGradient gradient(0, 0, size.width(), size.height());
+    gradient.setColorAt(0, QColor(20, 40, 90));
+    gradient.setColorAt(0.5, QColor(230, 200, 150));
+    gradient.setColorAt(1, QColor(40, 120, 60));
+    painter.fillRect(image.rect(), gradient);
+
+    // Some detail so codecs and histograms have real work to do.
+    QRandomGenerator random(42);
+    for (int i = 0; i < 2000; ++i) {
+        painter.fillRect(random.bounded(size.width()), random.bounded(size.height()),
+                         8, 8, QColor::fromRgb(random.generate()));
+    }
+
+    return image;
+}
+
+class StatusBarBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void parseDesktopFiles();
+    void matchItem_data();
+    void matchItem();
+
+    void imageToPixmap_data();
+    void imageToPixmap();
+
+    void demarshalLayout_data();
+    void demarshalLayout();
+    void getLayoutFinished_data();
+    void getLayoutFinished();
+    void menuMemory_data();
+    void menuMemory();
+
+    void analyzeImage_data();
+    void analyzeImage();
+    void analyzeFile_data();
+    void analyzeFile();
+
+    void trayModelUpdates_data();
+    void trayModelUpdates();
+
+private:
+    QDBusMessage layoutReply(int items);
+    QDBusMessage layoutReply(const DBusMenuLayoutItem &layout);
+    void loadCorpus(CApplications &apps);
+
+private:
+    QTemporaryDir m_dir;
+    QStringList m_desktopFiles;
+
+    QThread m_peerThread;
+    QDBusServer *m_server = nullptr;
+    LayoutPeer *m_peer = nullptr;
+    QDBusConnection m_connection = QDBusConnection(QString());
+};
+
+void StatusBarBenchmark::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+
+    for (int i = 0; i < s_corpusSize; ++i) {
+        const QString fileName = m_dir.filePath(QString("app-%1.desktop").arg(i));
+        QFile file(fileName);
+        QVERIFY(file.open(QIODevice::WriteOnly));
+
+        QTextStream stream(&file);
+        stream << "[Desktop Entry]\n"
+               << "Type=Application\n"
+               << "Name=Application " << i << "\n"
+               << "Name[de]=Anwendung " << i << "\n"
+               << "Comment=Generated entry " << i << "\n"
+               << "Exec=/usr/bin/app-" << i << " %U\n"
+               << "Icon=app-" << i << "\n";
+        if (i % 3 == 0)
+            stream << "StartupWMClass=App-" << i << "\n";
+        if (i % 25 == 0)
+            stream << "OnlyShowIn=Cutefish;KDE;\n";
+
+        m_desktopFiles << fileName;
+    }
+
+    // The peer lives on its own thread so blocking calls to it can't deadlock.
+    m_peerThread.start();
+    QObject context;
+    context.moveToThread(&m_peerThread);
+
+    QMetaObject::invokeMethod(&context, [this] {
+        m_peer = new LayoutPeer;
+        m_server = new QDBusServer(QStringLiteral("unix:tmpdir=") + QDir::tempPath());
+        connect(m_server, &QDBusServer::newConnection, m_server, [this] (const QDBusConnection &connection) {
+            QDBusConnection(connection).registerVirtualObject(s_menuPath, m_peer);
+        }, Qt::DirectConnection);
+    }, Qt::BlockingQueuedConnection);
+    context.moveToThread(thread());
+
+    QVERIFY(m_server->isConnected());
+    m_connection = QDBusConnection::connectToPeer(m_server->address(), QStringLiteral("statusbar-bench"));
+    QVERIFY(m_connection.isConnected());
+}
+
+void StatusBarBenchmark::cleanupTestCase()
+{
+    QDBusConnection::disconnectFromPeer(QStringLiteral("statusbar-bench"));
+
+    QMetaObject::invokeMethod(m_server, [this] {
+        delete m_server;
+        delete m_peer;
+    }, Qt::BlockingQueuedConnection);
+
+    m_peerThread.quit();
+    m_peerThread.wait();
+}
+
+QDBusMessage StatusBarBenchmark::layoutReply(int items)
+{
+    return layoutReply(syntheticLayout(items));
+}
+
+QDBusMessage StatusBarBenchmark::layoutReply(const DBusMenuLayoutItem &layout)
+{
+    m_peer->layout = layout;
+
+    QDBusMessage call = QDBusMessage::createMethodCall(QString(), s_menuPath,
+                                                       QStringLiteral("com.canonical.dbusmenu"),
+                                                       QStringLiteral("GetLayout"));
+    call << 0 << -1 << QStringList();
+
+    return m_connection.call(call);
+}
+
+void StatusBarBenchmark::loadCorpus(CApplications &apps)
+{
+    // Drop whatever the system has installed, only the corpus counts.
+    apps.removeApplications(apps.m_items);
+
+    for (const QString &fileName : std::as_const(m_desktopFiles))
+        apps.addApplication(fileName);
+}
+
+void StatusBarBenchmark::parseDesktopFiles()
+{
+    CApplications apps;
+
+    QBENCHMARK {
+        loadCorpus(apps);
+    }
+}
+
+void StatusBarBenchmark::matchItem_data()
+{
+    QTest::addColumn<QString>("windowClass");
+
+    QTest::newRow("first") << QStringLiteral("App-0");
+    QTest::newRow("last") << QString("App-%1").arg(s_corpusSize - 2);
+    QTest::newRow("none") << QStringLiteral("no-such-window");
+}
+
+void StatusBarBenchmark::matchItem()
+{
+    QFETCH(QString, windowClass);
+
+    CApplications apps;
+    loadCorpus(apps);
+
+    const quint32 pid = QCoreApplication::applicationPid();
+
+    QBENCHMARK {
+        apps.matchItem(pid, windowClass);
+    }
+}
+
+void StatusBarBenchmark::imageToPixmap_data()
+{
+    QTest::addColumn<QList<int>>("sizes");
+
+    for (int size : { 16, 22, 32, 48, 64, 128 })
+        QTest::newRow(QByteArray::number(size)) << QList<int> { size };
+
+    QTest::newRow("16-128") << QList<int> { 16, 22, 32, 48, 64, 128 };
+}
+
+void StatusBarBenchmark::imageToPixmap()
+{
+    QFETCH(QList<int>, sizes);
+
+    KDbusImageVector vector;
+    for (int size : sizes) {
+        KDbusImageStruct image;
+        image.width = size;
+        image.height = size;
+
+        // ARGB32 in network byte order, as items send it.
+        const QImage argb = syntheticWallpaper(QSize(size, size)).convertToFormat(QImage::Format_ARGB32);
+        image.data.resize(size * size * 4);
+        quint32 *pixels = reinterpret_cast<quint32 *>(image.data.data());
+        for (int i = 0; i < size * size; ++i)
+            pixels[i] = qToBigEndian(reinterpret_cast<const quint32 *>(argb.constBits())[i]);
+
+        vector.append(image);
+    }
+
+    StatusNotifierItemSource source(QStringLiteral(":1.0/StatusNotifierItem"));
+
+    QBENCHMARK {
+        source.imageVectorToPixmap(vector);
+    }
+}
+
+void StatusBarBenchmark::demarshalLayout_data()
+{
+    QTest::addColumn<int>("items");
+
+    QTest::newRow("10") << 10;
+    QTest::newRow("50") << 50;
+    QTest::newRow("200") << 200;
+}
+
+void StatusBarBenchmark::demarshalLayout()
+{
+    QFETCH(int, items);
+
+    DBusMenuTypes_register();
+    const QDBusMessage reply = layoutReply(items);
+    QCOMPARE(reply.type(), QDBusMessage::ReplyMessage);
+
+    QBENCHMARK {
+        qdbus_cast<DBusMenuLayoutItem>(reply.arguments().at(1));
+    }
+}
+
+void StatusBarBenchmark::getLayoutFinished_data()
+{
+    demarshalLayout_data();
+}
+
+void StatusBarBenchmark::getLayoutFinished()
+{
+    QFETCH(int, items);
+
+    DBusMenuImporter importer(QStringLiteral("org.example.Bench"), s_menuPath);
+    importer.menu();
+
+    const QDBusMessage reply = layoutReply(items);
+    QCOMPARE(reply.type(), QDBusMessage::ReplyMessage);
+
+    QBENCHMARK {
+        auto *watcher = new QDBusPendingCallWatcher(QDBusPendingCall::fromCompletedCall(reply));
+        // DBUSMENU_PROPERTY_ID, the root menu has id 0.
+        watcher->setProperty("_dbusmenu_id", 0);
+        importer.slotGetLayoutFinished(watcher);
+    }
+
+    QCoreApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete);
+}
+
+void StatusBarBenchmark::menuMemory_data()
+{
+    QTest::addColumn<bool>("open");
+    QTest::addColumn<bool>("close");
+
+    QTest::newRow("closed") << false << false;
+    QTest::newRow("allOpen") << true << false;
+    QTest::newRow("reopened") << true << true;
+}
+
+// Resident memory of a large exporter's menus, fetched the way AppMenuModel
+// does: the root first, then every top level submenu.
+void StatusBarBenchmark::menuMemory()
+{
+    QFETCH(bool, open);
+    QFETCH(bool, close);
+
+    QList<QPair<int, QDBusMessage>> replies;
+
+    DBusMenuLayoutItem root;
+    root.id = 0;
+    for (int i = 1; i <= s_wideMenus; ++i) {
+        DBusMenuLayoutItem item;
+        item.id = i;
+        item.properties.insert("label", QString("Menu _%1").arg(i));
+        item.properties.insert("children-display", "submenu");
+        root.children.append(item);
+    }
+    replies << qMakePair(0, layoutReply(root));
+
+    for (int i = 1; i <= s_wideMenus; ++i) {
+        DBusMenuLayoutItem submenu;
+        submenu.id = i;
+        for (int j = 0; j < s_wideMenuItems; ++j) {
+            DBusMenuLayoutItem item;
+            item.id = s_wideMenus + (i - 1) * s_wideMenuItems + j + 1;
+            item.properties.insert("label", QString("Entry _%1").arg(j));
+            item.properties.insert("icon-name", "document-open");
+            item.properties.insert("enabled", j % 7 != 0);
+            submenu.children.append(item);
+        }
+        replies << qMakePair(i, layoutReply(submenu));
+    }
+
+    for (const auto &reply : std::as_const(replies))
+        QCOMPARE(reply.second.type(), QDBusMessage::ReplyMessage);
+
+    QCoreApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete);
+    const qint64 before = StartupProfiler::residentMemory();
+
+    DBusMenuImporter importer(QStringLiteral("org.example.Bench"), s_menuPath);
+    QMenu *menu = importer.menu();
+
+    for (const auto &reply : std::as_const(replies)) {
+        auto *watcher = new QDBusPendingCallWatcher(QDBusPendingCall::fromCompletedCall(reply.second));
+        watcher->setProperty("_dbusmenu_id", reply.first);
+        importer.slotGetLayoutFinished(watcher);
+    }
+
+    for (QAction *action : menu->actions()) {
+        if (!action->menu())
+            continue;
+        if (open)
+            emit action->menu()->aboutToShow();
+        if (close)
+            emit action->menu()->aboutToHide();
+    }
+
+    // Let closed submenus release their actions.
+    QCoreApplication::processEvents();
+    QCoreApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete);
+
+    const qint64 after = StartupProfiler::residentMemory();
+    QVERIFY(before >= 0 && after >= 0);
+    QTest::setBenchmarkResult(qMax<qint64>(0, after - before) * 1024, QTest::BytesAllocated);
+}
+
+void StatusBarBenchmark::analyzeImage_data()
+{
+    QTest::addColumn<QSize>("size");
+    QTest::addColumn<bool>("regions");
+
+    // The strip under the bar at 80% of common screen widths. The average
+    // rows only sum the strip, the cost analyzeImage must stay within.
+    const QList<QPair<const char *, QSize>> sizes = {
+        { "1920", QSize(1536, 26) },
+        { "2560", QSize(2048, 32) },
+        { "3840", QSize(3072, 51) },
+    };
+
+    for (const auto &size : sizes) {
+        QTest::addRow("%s average", size.first) << size.second << false;
+        QTest::addRow("%s regions", size.first) << size.second << true;
+    }
+}
+
+void StatusBarBenchmark::analyzeImage()
+{
+    QFETCH(QSize, size);
+    QFETCH(bool, regions);
+
+    const QImage image = syntheticWallpaper(size);
+
+    if (regions) {
+        QBENCHMARK {
+            BackgroundHelper::analyzeImage(image);
+        }
+    } else {
+        QBENCHMARK {
+            BackgroundHelper::averageColor(image);
+        }
+    }
+}
+
+void StatusBarBenchmark::analyzeFile_data()
+{
+    QTest::addColumn<QByteArray>("format");
+
+    QTest::newRow("jpg") << QByteArray("jpg");
+    QTest::newRow("png") << QByteArray("png");
+}
+
+void StatusBarBenchmark::analyzeFile()
+{
+    QFETCH(QByteArray, format);
+
+    const QString fileName = m_dir.filePath("wallpaper." + QString::fromLatin1(format));
+    if (!QFile::exists(fileName))
+        QVERIFY(syntheticWallpaper(QSize(3840, 2160)).save(fileName, format.constData()));
+
+    QBENCHMARK {
+        BackgroundHelper::analyze(fileName, QSize(1920, 1080), 32);
+    }
+}
+
+void StatusBarBenchmark::trayModelUpdates_data()
+{
+    QTest::addColumn<int>("items");
+
+    QTest::newRow("100") << 100;
+    QTest::newRow("250") << 250;
+}
+
+void StatusBarBenchmark::trayModelUpdates()
+{
+    QFETCH(int, items);
+
+    SystemTrayModel model;
+
+    model.beginResetModel();
+    for (int i = 0; i < items; ++i) {
+        auto *source = new StatusNotifierItemSource(QString(":1.%1/StatusNotifierItem").arg(i + 1), &model);
+        source->m_iconName = QStringLiteral("application-x-executable");
+        model.m_items.append(source);
+    }
+    model.endResetModel();
+
+    // Every item reporting a change once, like a theme switch.
+    QBENCHMARK {
+        for (StatusNotifierItemSource *source : std::as_const(model.m_items))
+            model.updated(source);
+    }
+}
+
+// Converts QtTest's XML log into a flat JSON list for comparing builds.
+static bool writeJson(const QString &xmlFile, const QString &jsonFile)
+{
+    QFile xml(xmlFile);
+    if (!xml.open(QIODevice::ReadOnly))
+        return false;
+
+    QJsonArray results;
+    QString function;
+    QXmlStreamReader reader(&xml);
+
+    while (!reader.atEnd()) {
+        if (reader.readNext() != QXmlStreamReader::StartElement)
+            continue;
+
+        const QXmlStreamAttributes attributes = reader.attributes();
+
+        if (reader.name() == QLatin1String("TestFunction")) {
+            function = attributes.value("name").toString();
+        } else if (reader.name() == QLatin1String("BenchmarkResult")) {
+            results.append(QJsonObject {
+                { "function", function },
+                { "tag", attributes.value("tag").toString() },
+                { "metric", attributes.value("metric").toString() },
+                { "value", attributes.value("value").toDouble() },
+                { "iterations", attributes.value("iterations").toInt() },
+            });
+        }
+    }
+
+    QFile json(jsonFile);
+    if (reader.hasError() || !json.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+
+    const QJsonObject root {
+        { "qt", QString::fromLatin1(qVersion()) },
+        { "date", QDateTime::currentDateTimeUtc().toString(Qt::ISODate) },
+        { "results", results },
+    };
+    json.write(QJsonDocument(root).toJson());
+
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    // Keep the tray model off the desktop's session bus.
+    qputenv("DBUS_SESSION_BUS_ADDRESS", "unix:path=/nonexistent");
+
+    QApplication app(argc, argv);
+    StatusBarBenchmark bench;
+
+    // "-json <file>" writes the results as JSON, everything else goes to QtTest.
+    QStringList args = app.arguments();
+    const int jsonIndex = args.indexOf(QStringLiteral("-json"));
+
+    if (jsonIndex < 1 || jsonIndex + 1 >= args.size())
+        return QTest::qExec(&bench, args);
+
+    const QString jsonFile = args.at(jsonIndex + 1);
+    args.remove(jsonIndex, 2);
+
+    QTemporaryFile xml;
+    if (!xml.open())
+        return 1;
+
+    args << "-o" << xml.fileName() + ",xml" << "-o" << "-,txt";
+    const int result = QTest::qExec(&bench, args);
+
+    if (!writeJson(xml.fileName(), jsonFile)) {
+        qWarning() << "Cannot write" << jsonFile;
+        return 1;
+    }
+
+    return result;
+}
+
+#include "statusbar_bench.moc"
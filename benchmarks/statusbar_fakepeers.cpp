@@ -0,0 +1,585 @@
+/*
+ * Copyright (C) 2021 CutefishOS Team.
+ *
+ * Author:     cutefishos <cutefishos@foxmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Stand-in desktop services for benchmarks/run-e2e.sh.
+//
+// Exports fake Audio, PrimaryBattery and Brightness objects under
+// com.cutefish.Settings, registers tray items that each export a dbusmenu,
+// and then measures the bar from the outside: registration latency,
+// menu-open latency, CPU time and frames while idle.
+
+#include "systemtraytypes.h"
+#include "dbusmenutypes_p.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDBusConnection>
+#include <QDBusConnectionInterface>
+#include <QDBusMessage>
+#include <QDBusMetaType>
+#include <QDBusPendingCallWatcher>
+#include <QDBusServiceWatcher>
+#include <QDBusVirtualObject>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTimer>
+#include <QDebug>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <utility>
+#include <unistd.h>
+
+static const QString s_watcherService = QStringLiteral("org.kde.StatusNotifierWatcher");
+static const QString s_statusbarService = QStringLiteral("com.cutefish.Statusbar");
+static const QString s_itemPath = QStringLiteral("/StatusNotifierItem");
+static const QString s_menuPath = QStringLiteral("/MenuBar");
+
+// All timestamps are taken from this clock, virtual objects are called
+// from the DBus thread.
+static QElapsedTimer s_clock;
+
+class FakeAudio : public QObject
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "com.cutefish.Audio")
+    Q_PROPERTY(int volume READ volume NOTIFY volumeChanged)
+    Q_PROPERTY(bool mute READ mute NOTIFY muteChanged)
+
+public:
+    using QObject::QObject;
+
+    int volume() const { return m_volume; }
+    bool mute() const { return m_mute; }
+
+public slots:
+    void setVolume(int volume)
+    {
+        if (volume != m_volume) {
+            m_volume = volume;
+            emit volumeChanged(m_volume);
+        }
+    }
+
+    void setMute(bool mute)
+    {
+        if (mute != m_mute) {
+            m_mute = mute;
+            emit muteChanged(m_mute);
+        }
+    }
+
+signals:
+    void volumeChanged(int volume);
+    void muteChanged(bool mute);
+
+private:
+    int m_volume = 50;
+    bool m_mute = false;
+};
+
+class FakeBattery : public QObject
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "com.cutefish.PrimaryBattery")
+    Q_PROPERTY(int chargeState READ chargeState NOTIFY chargeStateChanged)
+    Q_PROPERTY(int chargePercent READ chargePercent NOTIFY chargePercentChanged)
+    Q_PROPERTY(int lastChargedPercent READ lastChargedPercent NOTIFY lastChargedPercentChanged)
+    Q_PROPERTY(int capacity READ capacity NOTIFY capacityChanged)
+    Q_PROPERTY(QString statusString READ statusString)
+
+public:
+    using QObject::QObject;
+
+    int chargeState() const { return 2; }
+    int chargePercent() const { return m_percent; }
+    int lastChargedPercent() const { return 100; }
+    int capacity() const { return 90; }
+    QString statusString() const { return QString("%1 minutes remaining").arg(m_percent * 3); }
+
+    void drain()
+    {
+        m_percent = m_percent > 1 ? m_percent - 1 : 100;
+        emit chargePercentChanged(m_percent);
+        emit remainingTimeChanged(m_percent * 180);
+    }
+
+signals:
+    void chargeStateChanged(int state);
+    void chargePercentChanged(int percent);
+    void lastChargedPercentChanged(int percent);
+    void capacityChanged(int capacity);
+    void remainingTimeChanged(qlonglong time);
+
+private:
+    int m_percent = 80;
+};
+
+class FakeBrightness : public QObject
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "com.cutefish.Brightness")
+    Q_PROPERTY(int brightness READ brightness NOTIFY brightnessChanged)
+    Q_PROPERTY(bool brightnessEnabled READ brightnessEnabled CONSTANT)
+
+public:
+    using QObject::QObject;
+
+    int brightness() const { return m_value; }
+    bool brightnessEnabled() const { return true; }
+
+public slots:
+    void setValue(int value)
+    {
+        if (value != m_value) {
+            m_value = value;
+            emit brightnessChanged(m_value);
+        }
+    }
+
+signals:
+    void brightnessChanged(int value);
+
+private:
+    int m_value = 70;
+};
+
+// A StatusNotifierItem with a dbusmenu, on its own connection so every
+// item has a unique name like a real application.
+class FakeItem : public QDBusVirtualObject
+{
+public:
+    FakeItem(const QString &address, int index, int menuSize)
+        : m_index(index)
+        , m_menuSize(menuSize)
+        , m_connection(QDBusConnection::connectToBus(address, QString("fake-item-%1").arg(index)))
+    {
+        m_connection.registerVirtualObject(s_itemPath, this);
+        m_connection.registerVirtualObject(s_menuPath, this);
+    }
+
+    ~FakeItem()
+    {
+        QDBusConnection::disconnectFromBus(m_connection.name());
+    }
+
+    QString id() const
+    {
+        return m_connection.baseService() + s_itemPath;
+    }
+
+    QDBusPendingCall registerItem()
+    {
+        QDBusMessage message = QDBusMessage::createMethodCall(s_watcherService,
+                                                              QStringLiteral("/StatusNotifierWatcher"),
+                                                              s_watcherService,
+                                                              QStringLiteral("RegisterStatusNotifierItem"));
+        message << m_connection.baseService();
+
+        m_registeredAt = s_clock.elapsed();
+        return m_connection.asyncCall(message);
+    }
+
+    // Milliseconds from registering until the bar fetched the properties.
+    qint64 registrationLatency() const
+    {
+        const qint64 fetched = m_fetchedAt;
+        return fetched < 0 ? -1 : fetched - m_registeredAt;
+    }
+
+    void update()
+    {
+        static const char *const signalNames[] = { "NewIcon", "NewToolTip", "NewTitle" };
+
+        ++m_generation;
+        m_connection.send(QDBusMessage::createSignal(s_itemPath, QStringLiteral("org.kde.StatusNotifierItem"),
+                                                     QLatin1String(signalNames[m_generation % 3])));
+    }
+
+    QString introspect(const QString &) const override
+    {
+        return QString();
+    }
+
+    bool handleMessage(const QDBusMessage &message, const QDBusConnection &connection) override
+    {
+        const QString member = message.member();
+        QDBusMessage reply = message.createReply();
+
+        if (message.interface() == QLatin1String("org.freedesktop.DBus.Properties")) {
+            const QString interface = message.arguments().value(0).toString();
+            const QVariantMap properties = interface == QLatin1String("com.canonical.dbusmenu")
+                    ? QVariantMap { { "Version", 3u }, { "Status", "normal" } }
+                    : itemProperties();
+
+            if (message.path() == s_itemPath && m_fetchedAt < 0)
+                m_fetchedAt = s_clock.elapsed();
+
+            if (member == QLatin1String("GetAll"))
+                reply << properties;
+            else if (member == QLatin1String("Get"))
+                reply << QVariant::fromValue(QDBusVariant(properties.value(message.arguments().value(1).toString())));
+        } else if (member == QLatin1String("GetLayout")) {
+            reply << uint(m_generation) << QVariant::fromValue(layout(message.arguments().value(0).toInt()));
+        } else if (member == QLatin1String("AboutToShow")) {
+            // Always ask for a refresh so every open includes a GetLayout.
+            reply << true;
+        } else if (member == QLatin1String("AboutToShowGroup")) {
+            reply << QList<int>() << QList<int>();
+        } else if (member == QLatin1String("GetGroupProperties")) {
+            reply << QVariant::fromValue(DBusMenuItemList());
+        } else if (member == QLatin1String("EventGroup")) {
+            reply << QList<int>();
+        }
+
+        return connection.send(reply);
+    }
+
+private:
+    QVariantMap itemProperties() const
+    {
+        // A 22px icon whose colour follows the update generation.
+        KDbusImageStruct image;
+        image.width = 22;
+        image.height = 22;
+        image.data.fill(char(m_generation * 40 + m_index), 22 * 22 * 4);
+
+        KDbusToolTipStruct toolTip;
+        toolTip.title = QString("Fake item %1").arg(m_index);
+        toolTip.subTitle = QString("Update %1").arg(m_generation);
+
+        return QVariantMap {
+            { "Category", "ApplicationStatus" },
+            { "Id", QString("fake-item-%1").arg(m_index) },
+            { "Title", QString("Fake item %1 (%2)").arg(m_index).arg(m_generation) },
+            { "Status", "Active" },
+            { "IconName", QString() },
+            { "IconPixmap", QVariant::fromValue(KDbusImageVector { image }) },
+            { "ToolTip", QVariant::fromValue(toolTip) },
+            { "Menu", QVariant::fromValue(QDBusObjectPath(s_menuPath)) },
+            { "ItemIsMenu", false },
+        };
+    }
+
+    DBusMenuLayoutItem layout(int parentId) const
+    {
+        DBusMenuLayoutItem root;
+        root.id = parentId;
+
+        if (parentId != 0)
+            return root;
+
+        for (int i = 1; i <= m_menuSize; ++i) {
+            DBusMenuLayoutItem item;
+            item.id = i;
+            if (i % 8 == 0) {
+                item.properties.insert("type", "separator");
+            } else {
+                item.properties.insert("label", QString("Action _%1").arg(i));
+                item.properties.insert("icon-name", "document-open");
+            }
+            root.children.append(item);
+        }
+
+        return root;
+    }
+
+private:
+    const int m_index;
+    const int m_menuSize;
+    QDBusConnection m_connection;
+    std::atomic<int> m_generation { 0 };
+    qint64 m_registeredAt = 0;
+    std::atomic<qint64> m_fetchedAt { -1 };
+};
+
+struct Options
+{
+    int items;
+    double updateRate;
+    int menuSize;
+    int menuOpens;
+    int idleSeconds;
+    double serviceRate;
+    QString output;
+};
+
+class Harness : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit Harness(const Options &options)
+        : m_options(options)
+    {
+    }
+
+    ~Harness()
+    {
+        qDeleteAll(m_items);
+    }
+
+    void start()
+    {
+        QDBusConnection bus = QDBusConnection::sessionBus();
+        bus.registerObject("/Audio", &m_audio, QDBusConnection::ExportAllContents);
+        bus.registerObject("/PrimaryBattery", &m_battery, QDBusConnection::ExportAllContents);
+        bus.registerObject("/Brightness", &m_brightness, QDBusConnection::ExportAllContents);
+        if (!bus.registerService("com.cutefish.Settings"))
+            qWarning() << "com.cutefish.Settings is already taken, the bar talks to the real one";
+
+        waitForService(s_statusbarService, [this] {
+            waitForService(s_watcherService, [this] { registerItems(); });
+        });
+    }
+
+private:
+    void waitForService(const QString &service, std::function<void()> next)
+    {
+        if (QDBusConnection::sessionBus().interface()->isServiceRegistered(service)) {
+            next();
+            return;
+        }
+
+        auto *watcher = new QDBusServiceWatcher(service, QDBusConnection::sessionBus(),
+                                                QDBusServiceWatcher::WatchForRegistration, this);
+        connect(watcher, &QDBusServiceWatcher::serviceRegistered, this, [watcher, next] {
+            watcher->deleteLater();
+            next();
+        });
+
+        QTimer::singleShot(30000, watcher, [service] {
+            qCritical() << "Timed out waiting for" << service;
+            QCoreApplication::exit(1);
+        });
+    }
+
+    void registerItems()
+    {
+        m_pid = QDBusConnection::sessionBus().interface()->servicePid(s_statusbarService);
+        const QString address = qEnvironmentVariable("DBUS_SESSION_BUS_ADDRESS");
+
+        for (int i = 0; i < m_options.items; ++i) {
+            FakeItem *item = new FakeItem(address, i, m_options.menuSize);
+            m_items.append(item);
+            item->registerItem();
+        }
+
+        // Give the bar a moment to fetch every item before opening menus.
+        auto *poll = new QTimer(this);
+        QElapsedTimer waited;
+        waited.start();
+        connect(poll, &QTimer::timeout, this, [=] {
+            const bool done = std::all_of(m_items.cbegin(), m_items.cend(), [](FakeItem *item) {
+                return item->registrationLatency() >= 0;
+            });
+
+            if (done || waited.elapsed() > 10000) {
+                poll->deleteLater();
+                QTimer::singleShot(500, this, [this] { openMenu(0); });
+            }
+        });
+        poll->start(50);
+    }
+
+    void openMenu(int count)
+    {
+        if (count >= m_options.menuOpens || m_items.isEmpty()) {
+            startIdle();
+            return;
+        }
+
+        QDBusMessage message = QDBusMessage::createMethodCall(s_statusbarService,
+                                                              QStringLiteral("/Harness"),
+                                                              QStringLiteral("com.cutefish.Statusbar.Harness"),
+                                                              QStringLiteral("openTrayMenu"));
+        message << m_items.at(count % m_items.size())->id();
+
+        auto *watcher = new QDBusPendingCallWatcher(QDBusConnection::sessionBus().asyncCall(message, 5000), this);
+        connect(watcher, &QDBusPendingCallWatcher::finished, this, [=] {
+            watcher->deleteLater();
+
+            const QDBusMessage reply = watcher->reply();
+            m_menuLatencies.append(reply.type() == QDBusMessage::ReplyMessage
+                                   ? reply.arguments().value(0).toInt() : -1);
+
+            QTimer::singleShot(200, this, [=] { openMenu(count + 1); });
+        });
+    }
+
+    void startIdle()
+    {
+        if (m_options.updateRate > 0) {
+            auto *updates = new QTimer(this);
+            connect(updates, &QTimer::timeout, this, [this] {
+                for (FakeItem *item : std::as_const(m_items))
+                    item->update();
+            });
+            updates->start(int(1000 / m_options.updateRate));
+        }
+
+        if (m_options.serviceRate > 0) {
+            auto *services = new QTimer(this);
+            connect(services, &QTimer::timeout, this, [this] {
+                m_audio.setVolume((m_audio.volume() + 7) % 100);
+                m_brightness.setValue((m_brightness.brightness() + 5) % 100);
+                m_battery.drain();
+            });
+            services->start(int(1000 / m_options.serviceRate));
+        }
+
+        m_idleCpuStart = cpuTime();
+        m_idleFramesStart = frames();
+        m_idleClock.start();
+
+        QTimer::singleShot(m_options.idleSeconds * 1000, this, [this] { finish(); });
+    }
+
+    void finish()
+    {
+        const double minutes = m_idleClock.elapsed() / 60000.0;
+
+        QJsonArray registration;
+        for (FakeItem *item : std::as_const(m_items))
+            registration.append(item->registrationLatency());
+
+        QJsonArray menus;
+        for (int latency : std::as_const(m_menuLatencies))
+            menus.append(latency);
+
+        const QJsonObject result {
+            { "items", m_options.items },
+            { "updateRate", m_options.updateRate },
+            { "menuSize", m_options.menuSize },
+            { "serviceRate", m_options.serviceRate },
+            { "platform", qEnvironmentVariable("QT_QPA_PLATFORM") },
+            { "registrationLatencyMs", registration },
+            { "menuOpenLatencyMs", menus },
+            { "idleSeconds", m_idleClock.elapsed() / 1000.0 },
+            { "cpuMsPerMinute", (cpuTime() - m_idleCpuStart) / minutes },
+            { "framesPerMinute", (frames() - m_idleFramesStart) / minutes },
+        };
+
+        const QByteArray json = QJsonDocument(result).toJson();
+
+        if (m_options.output.isEmpty()) {
+            QFile out;
+            out.open(stdout, QIODevice::WriteOnly);
+            out.write(json);
+        } else {
+            QFile out(m_options.output);
+            if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+                qCritical() << "Cannot write" << m_options.output;
+                QCoreApplication::exit(1);
+                return;
+            }
+            out.write(json);
+        }
+
+        QCoreApplication::quit();
+    }
+
+    // User and system time of the bar in milliseconds.
+    qint64 cpuTime() const
+    {
+        QFile file(QString("/proc/%1/stat").arg(m_pid));
+        if (!file.open(QIODevice::ReadOnly))
+            return 0;
+
+        // The command may contain spaces, fields are counted after it.
+        const QByteArray stat = file.readAll();
+        const QList<QByteArray> fields = stat.mid(stat.lastIndexOf(')') + 2).split(' ');
+        if (fields.size() < 13)
+            return 0;
+
+        const qint64 ticks = fields.at(11).toLongLong() + fields.at(12).toLongLong();
+        return ticks * 1000 / sysconf(_SC_CLK_TCK);
+    }
+
+    qint64 frames() const
+    {
+        QDBusMessage message = QDBusMessage::createMethodCall(s_statusbarService,
+                                                              QStringLiteral("/Statusbar"),
+                                                              QStringLiteral("com.cutefish.Statusbar"),
+                                                              QStringLiteral("frameStatistics"));
+        const QDBusMessage reply = QDBusConnection::sessionBus().call(message);
+        return reply.arguments().value(0).toMap().value("frames").toLongLong();
+    }
+
+private:
+    const Options m_options;
+
+    FakeAudio m_audio;
+    FakeBattery m_battery;
+    FakeBrightness m_brightness;
+    QList<FakeItem *> m_items;
+
+    uint m_pid = 0;
+    QList<int> m_menuLatencies;
+    QElapsedTimer m_idleClock;
+    qint64 m_idleCpuStart = 0;
+    qint64 m_idleFramesStart = 0;
+};
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    s_clock.start();
+
+    qDBusRegisterMetaType<KDbusImageStruct>();
+    qDBusRegisterMetaType<KDbusImageVector>();
+    qDBusRegisterMetaType<KDbusToolTipStruct>();
+    DBusMenuTypes_register();
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Fake desktop services for measuring cutefish-statusbar");
+    parser.addHelpOption();
+
+    QCommandLineOption itemsOption("items", "Number of tray items.", "n", "10");
+    QCommandLineOption updateRateOption("update-rate", "Updates per second of every tray item while idle.", "hz", "0");
+    QCommandLineOption menuSizeOption("menu-size", "Entries in every tray menu.", "n", "20");
+    QCommandLineOption menuOpensOption("menu-opens", "Tray menus to open.", "n", "10");
+    QCommandLineOption idleOption("idle", "Seconds to measure CPU and frames for.", "s", "60");
+    QCommandLineOption serviceRateOption("service-rate", "Audio, battery and brightness changes per second.", "hz", "0");
+    QCommandLineOption outputOption("output", "Write the JSON results here instead of stdout.", "file");
+    parser.addOptions({ itemsOption, updateRateOption, menuSizeOption, menuOpensOption,
+                        idleOption, serviceRateOption, outputOption });
+    parser.process(app);
+
+    const Options options {
+        parser.value(itemsOption).toInt(),
+        parser.value(updateRateOption).toDouble(),
+        parser.value(menuSizeOption).toInt(),
+        parser.value(menuOpensOption).toInt(),
+        parser.value(idleOption).toInt(),
+        parser.value(serviceRateOption).toDouble(),
+        parser.value(outputOption),
+    };
+
+    Harness harness(options);
+    harness.start();
+
+    return app.exec();
+}
+
+#include "statusbar_fakepeers.moc"
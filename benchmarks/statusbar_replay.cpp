@@ -0,0 +1,783 @@
+/*
+ * Copyright (C) 2021 CutefishOS Team.
+ *
+ * Author:     cutefishos <cutefishos@foxmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Plays a capture made with CUTEFISH_STATUSBAR_RECORD back against the bar.
+//
+// Every peer of the recorded session gets its own connection and takes the
+// well-known names it owned, giving them up and taking them again where the
+// capture shows their owner changing. Signals and calls the peers sent are replayed
+// at their recorded time, calls from the bar are answered with the recorded
+// reply after the recorded delay. Unique names inside message bodies are
+// rewritten to the names of this session.
+//
+// libdbus is used directly since it can demarshal the raw messages of the
+// capture, QtDBus cannot.
+
+#include <dbus/dbus.h>
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSet>
+#include <QtEndian>
+#include <QDebug>
+
+#include <algorithm>
+#include <utility>
+#include <poll.h>
+#include <unistd.h>
+
+static const char *s_busName = "org.freedesktop.DBus";
+static const int s_linkTypeDBus = 231;
+
+struct Record
+{
+    qint64 time;    // microseconds
+    DBusMessage *message;
+};
+
+struct Peer
+{
+    QByteArray recordedName;
+    QList<QByteArray> names;
+    DBusConnection *connection = nullptr;
+    QByteArray uniqueName;
+};
+
+struct RecordedReply
+{
+    const Record *reply;
+    qint64 latency;
+};
+
+struct PendingReply
+{
+    qint64 due;
+    int peer;
+    DBusMessage *call;
+    const Record *reply;
+};
+
+static QByteArray bytes(const char *string)
+{
+    return string ? QByteArray(string) : QByteArray();
+}
+
+static quint32 readUInt32(const char *data, bool swapped)
+{
+    quint32 value;
+    memcpy(&value, data, sizeof(value));
+    return swapped ? qbswap(value) : value;
+}
+
+static QList<Record> readCapture(const QString &fileName)
+{
+    QList<Record> records;
+    QFile file(fileName);
+
+    if (!file.open(QIODevice::ReadOnly)) {
+        qCritical() << "Cannot read" << fileName;
+        return records;
+    }
+
+    const QByteArray data = file.readAll();
+    if (data.size() < 24) {
+        qCritical() << fileName << "is not a pcap file";
+        return records;
+    }
+
+    const quint32 magic = readUInt32(data.constData(), false);
+    bool swapped = false;
+    bool nanoseconds = false;
+
+    switch (magic) {
+    case 0xa1b2c3d4: break;
+    case 0xd4c3b2a1: swapped = true; break;
+    case 0xa1b23c4d: nanoseconds = true; break;
+    case 0x4d3cb2a1: swapped = nanoseconds = true; break;
+    default:
+        qCritical() << fileName << "is not a pcap file";
+        return records;
+    }
+
+    if (readUInt32(data.constData() + 20, swapped) != s_linkTypeDBus) {
+        qCritical() << fileName << "does not contain DBus messages";
+        return records;
+    }
+
+    int offset = 24;
+    while (offset + 16 <= data.size()) {
+        const qint64 seconds = readUInt32(data.constData() + offset, swapped);
+        const qint64 fraction = readUInt32(data.constData() + offset + 4, swapped);
+        const int length = readUInt32(data.constData() + offset + 8, swapped);
+        offset += 16;
+
+        if (length < 0 || offset + length > data.size())
+            break;
+
+        DBusError error;
+        dbus_error_init(&error);
+        DBusMessage *message = dbus_message_demarshal(data.constData() + offset, length, &error);
+        offset += length;
+
+        if (!message) {
+            qWarning() << "Skipping a message:" << error.message;
+            dbus_error_free(&error);
+            continue;
+        }
+
+        records.append({ seconds * 1000000 + (nanoseconds ? fraction / 1000 : fraction), message });
+    }
+
+    return records;
+}
+
+// Copies the arguments of one message into another, replacing strings
+// that are unique names of the recorded session.
+static void copyArguments(DBusMessageIter *from, DBusMessageIter *to, const QHash<QByteArray, QByteArray> &names)
+{
+    int type;
+
+    while ((type = dbus_message_iter_get_arg_type(from)) != DBUS_TYPE_INVALID) {
+        if (type == DBUS_TYPE_UNIX_FD) {
+            // Not part of a capture.
+        } else if (dbus_type_is_basic(type)) {
+            DBusBasicValue value;
+            dbus_message_iter_get_basic(from, &value);
+
+            if (type == DBUS_TYPE_STRING) {
+                auto it = names.constFind(QByteArray(value.str));
+                if (it != names.constEnd())
+                    value.str = const_cast<char *>(it->constData());
+            }
+
+            dbus_message_iter_append_basic(to, type, &value);
+        } else {
+            DBusMessageIter fromSub;
+            DBusMessageIter toSub;
+            dbus_message_iter_recurse(from, &fromSub);
+
+            char *signature = nullptr;
+            const char *contained = nullptr;
+            if (type == DBUS_TYPE_ARRAY) {
+                signature = dbus_message_iter_get_signature(from);
+                contained = signature + 1;
+            } else if (type == DBUS_TYPE_VARIANT) {
+                signature = dbus_message_iter_get_signature(&fromSub);
+                contained = signature;
+            }
+
+            dbus_message_iter_open_container(to, type, contained, &toSub);
+
+            const int elementType = type == DBUS_TYPE_ARRAY ? dbus_message_iter_get_element_type(from) : DBUS_TYPE_INVALID;
+            if (elementType != DBUS_TYPE_INVALID && elementType != DBUS_TYPE_UNIX_FD && dbus_type_is_fixed(elementType)) {
+                // Icon pixmaps, copied in one go.
+                const void *elements = nullptr;
+                int count = 0;
+                dbus_message_iter_get_fixed_array(&fromSub, &elements, &count);
+                dbus_message_iter_append_fixed_array(&toSub, elementType, &elements, count);
+            } else {
+                copyArguments(&fromSub, &toSub, names);
+            }
+
+            dbus_message_iter_close_container(to, &toSub);
+            dbus_free(signature);
+        }
+
+        dbus_message_iter_next(from);
+    }
+}
+
+static void copyArguments(DBusMessage *from, DBusMessage *to, const QHash<QByteArray, QByteArray> &names)
+{
+    DBusMessageIter fromIter;
+    DBusMessageIter toIter;
+
+    if (!dbus_message_iter_init(from, &fromIter))
+        return;
+
+    dbus_message_iter_init_append(to, &toIter);
+    copyArguments(&fromIter, &toIter, names);
+}
+
+class Replay
+{
+public:
+    Replay(const QList<Record> &records, double speed)
+        : m_records(records)
+        , m_speed(speed)
+    {
+    }
+
+    bool analyze(const QByteArray &self);
+    bool connectPeers();
+    int run(int lingerSeconds);
+    QJsonObject summary() const;
+
+private:
+    int peerFor(const QByteArray &name);
+    QByteArray mapped(const char *name) const;
+    qint64 scaled(qint64 time) const;
+    qint64 now() const;
+
+    void receive(int peer, DBusMessage *message);
+    void sendRecorded(const Record &record);
+    void changeOwner(DBusMessage *signal);
+    void sendReply(const PendingReply &pending);
+    void start(const QByteArray &statusbar);
+    qint64 cpuTime() const;
+
+private:
+    const QList<Record> m_records;
+    const double m_speed;
+
+    QByteArray m_self;
+    qint64 m_captureStart = 0;
+    QList<Peer> m_peers;
+    QHash<QByteArray, int> m_peerByName;
+    QList<const Record *> m_scheduled;
+    QSet<QByteArray> m_appearing;
+    QHash<QString, QList<RecordedReply>> m_replies;
+
+    QHash<QByteArray, QByteArray> m_names;
+    QElapsedTimer m_clock;
+    qint64 m_started = -1;
+    QByteArray m_statusbar;
+    uint m_pid = 0;
+    qint64 m_cpuStart = 0;
+
+    QList<PendingReply> m_pending;
+    int m_sent = 0;
+    int m_replied = 0;
+    int m_unmatched = 0;
+    qint64 m_cpu = 0;
+    qint64 m_duration = 0;
+};
+
+static QString replyKey(int peer, DBusMessage *call)
+{
+    return QString("%1 %2 %3.%4").arg(peer)
+            .arg(QString::fromUtf8(bytes(dbus_message_get_path(call))))
+            .arg(QString::fromUtf8(bytes(dbus_message_get_interface(call))))
+            .arg(QString::fromUtf8(bytes(dbus_message_get_member(call))));
+}
+
+int Replay::peerFor(const QByteArray &name)
+{
+    auto it = m_peerByName.constFind(name);
+    if (it != m_peerByName.constEnd())
+        return *it;
+
+    Peer peer;
+    peer.recordedName = name;
+
+    m_peers.append(peer);
+    m_peerByName.insert(name, m_peers.size() - 1);
+    return m_peers.size() - 1;
+}
+
+bool Replay::analyze(const QByteArray &self)
+{
+    m_self = self;
+
+    // Without --self the bar is the unique name in most calls and replies.
+    if (m_self.isEmpty()) {
+        QHash<QByteArray, int> counts;
+        for (const Record &record : m_records) {
+            if (dbus_message_get_type(record.message) == DBUS_MESSAGE_TYPE_SIGNAL)
+                continue;
+            for (const QByteArray &name : { bytes(dbus_message_get_sender(record.message)),
+                                            bytes(dbus_message_get_destination(record.message)) }) {
+                if (name.startsWith(':'))
+                    ++counts[name];
+            }
+        }
+
+        int most = 0;
+        for (auto it = counts.constBegin(); it != counts.constEnd(); ++it) {
+            if (it.value() > most) {
+                most = it.value();
+                m_self = it.key();
+            }
+        }
+    }
+
+    if (m_self.isEmpty()) {
+        qCritical() << "The capture has no calls to or from the bar";
+        return false;
+    }
+
+    QHash<dbus_uint32_t, const Record *> calls;
+    QList<const Record *> ownerChanges;
+    m_captureStart = -1;
+
+    for (const Record &record : m_records) {
+        DBusMessage *message = record.message;
+        const int type = dbus_message_get_type(message);
+        const QByteArray sender = bytes(dbus_message_get_sender(message));
+        const QByteArray destination = bytes(dbus_message_get_destination(message));
+
+        if (sender == m_self) {
+            if (m_captureStart < 0)
+                m_captureStart = record.time;
+            if (type == DBUS_MESSAGE_TYPE_METHOD_CALL && destination != s_busName)
+                calls.insert(dbus_message_get_serial(message), &record);
+            continue;
+        }
+
+        if (sender == s_busName && type == DBUS_MESSAGE_TYPE_SIGNAL
+                && bytes(dbus_message_get_member(message)) == "NameOwnerChanged") {
+            ownerChanges.append(&record);
+            continue;
+        }
+
+        if (sender == s_busName || sender.isEmpty())
+            continue;
+
+        if (type == DBUS_MESSAGE_TYPE_METHOD_RETURN || type == DBUS_MESSAGE_TYPE_ERROR) {
+            const Record *call = calls.take(dbus_message_get_reply_serial(message));
+            if (destination != m_self || !call)
+                continue;
+
+            // The owner of the name the bar called.
+            const QByteArray calledName = bytes(dbus_message_get_destination(call->message));
+            int peer = peerFor(sender);
+            if (calledName != sender && !m_peerByName.contains(calledName)) {
+                m_peers[peer].names.append(calledName);
+                m_peerByName.insert(calledName, peer);
+            }
+            peer = m_peerByName.value(calledName);
+
+            m_replies[replyKey(peer, call->message)].append({ &record, record.time - call->time });
+        } else {
+            // Calls captured here went to the bar, by unique or well-known name.
+            m_scheduled.append(&record);
+        }
+    }
+
+    // Broadcast signals only from peers the bar actually talked to.
+    QSet<QByteArray> talked;
+    for (const Record &record : m_records) {
+        const QByteArray sender = bytes(dbus_message_get_sender(record.message));
+        if (dbus_message_get_type(record.message) != DBUS_MESSAGE_TYPE_SIGNAL && sender != m_self)
+            talked.insert(sender);
+    }
+
+    m_scheduled.erase(std::remove_if(m_scheduled.begin(), m_scheduled.end(), [&](const Record *record) {
+        const QByteArray destination = bytes(dbus_message_get_destination(record->message));
+        return destination != m_self && !talked.contains(bytes(dbus_message_get_sender(record->message)));
+    }), m_scheduled.end());
+
+    for (const Record *record : std::as_const(m_scheduled))
+        peerFor(bytes(dbus_message_get_sender(record->message)));
+
+    if (m_peers.isEmpty()) {
+        qCritical() << "The capture has no peers of" << m_self;
+        return false;
+    }
+
+    // Peers' names come and go at the recorded times. A name whose first
+    // change is appearing is not owned when the replay starts.
+    QSet<QByteArray> changed;
+    for (const Record *record : std::as_const(ownerChanges)) {
+        const char *name = nullptr;
+        const char *oldOwner = nullptr;
+        const char *newOwner = nullptr;
+        if (!dbus_message_get_args(record->message, nullptr, DBUS_TYPE_STRING, &name, DBUS_TYPE_STRING, &oldOwner,
+                                   DBUS_TYPE_STRING, &newOwner, DBUS_TYPE_INVALID))
+            continue;
+
+        const QByteArray wellKnown = bytes(name);
+        if (wellKnown.startsWith(':') || !m_peerByName.contains(wellKnown))
+            continue;
+
+        if (!changed.contains(wellKnown) && !*oldOwner)
+            m_appearing.insert(wellKnown);
+        changed.insert(wellKnown);
+
+        m_scheduled.append(record);
+    }
+
+    std::stable_sort(m_scheduled.begin(), m_scheduled.end(), [](const Record *a, const Record *b) {
+        return a->time < b->time;
+    });
+
+    if (m_captureStart < 0)
+        m_captureStart = m_records.first().time;
+
+    qInfo().noquote() << QString("Bar %1, %2 peers, %3 messages to replay, %4 recorded calls")
+                         .arg(QString::fromUtf8(m_self)).arg(m_peers.size())
+                         .arg(m_scheduled.size()).arg(m_replies.size());
+    return true;
+}
+
+bool Replay::connectPeers()
+{
+    for (int i = 0; i < m_peers.size(); ++i) {
+        Peer &peer = m_peers[i];
+        DBusError error;
+        dbus_error_init(&error);
+
+        peer.connection = dbus_bus_get_private(DBUS_BUS_SESSION, &error);
+        if (!peer.connection) {
+            qCritical() << "Cannot connect to the session bus:" << error.message;
+            dbus_error_free(&error);
+            return false;
+        }
+
+        dbus_connection_set_exit_on_disconnect(peer.connection, false);
+        peer.uniqueName = bytes(dbus_bus_get_unique_name(peer.connection));
+
+        for (const QByteArray &name : std::as_const(peer.names)) {
+            if (m_appearing.contains(name))
+                continue;
+
+            if (dbus_bus_request_name(peer.connection, name.constData(), DBUS_NAME_FLAG_DO_NOT_QUEUE, &error)
+                    != DBUS_REQUEST_NAME_REPLY_PRIMARY_OWNER) {
+                qWarning() << "Cannot own" << name << error.message;
+                dbus_error_free(&error);
+            }
+        }
+
+        if (peer.recordedName.startsWith(':'))
+            m_names.insert(peer.recordedName, peer.uniqueName);
+    }
+
+    return true;
+}
+
+QByteArray Replay::mapped(const char *name) const
+{
+    const QByteArray recorded = bytes(name);
+    return m_names.value(recorded, recorded);
+}
+
+qint64 Replay::scaled(qint64 time) const
+{
+    return m_speed > 0 ? qint64(time / m_speed) : 0;
+}
+
+qint64 Replay::now() const
+{
+    return m_clock.nsecsElapsed() / 1000;
+}
+
+void Replay::start(const QByteArray &statusbar)
+{
+    m_statusbar = statusbar;
+    m_names.insert(m_self, m_statusbar);
+    m_started = now();
+
+    DBusMessage *call = dbus_message_new_method_call(s_busName, "/org/freedesktop/DBus", s_busName,
+                                                     "GetConnectionUnixProcessID");
+    const char *name = m_statusbar.constData();
+    dbus_message_append_args(call, DBUS_TYPE_STRING, &name, DBUS_TYPE_INVALID);
+
+    DBusMessage *reply = dbus_connection_send_with_reply_and_block(m_peers.first().connection, call, 1000, nullptr);
+    if (reply) {
+        dbus_message_get_args(reply, nullptr, DBUS_TYPE_UINT32, &m_pid, DBUS_TYPE_INVALID);
+        dbus_message_unref(reply);
+    }
+    dbus_message_unref(call);
+
+    m_cpuStart = cpuTime();
+}
+
+void Replay::receive(int peer, DBusMessage *message)
+{
+    if (dbus_message_get_type(message) != DBUS_MESSAGE_TYPE_METHOD_CALL)
+        return;
+
+    // The bar is the only other client, its first call starts the clock.
+    if (m_started < 0)
+        start(bytes(dbus_message_get_sender(message)));
+
+    auto it = m_replies.find(replyKey(peer, message));
+
+    if (it == m_replies.end() || it->isEmpty()) {
+        ++m_unmatched;
+        if (!dbus_message_get_no_reply(message)) {
+            DBusMessage *error = dbus_message_new_error(message, DBUS_ERROR_UNKNOWN_METHOD, "Not in the capture");
+            dbus_connection_send(m_peers.at(peer).connection, error, nullptr);
+            dbus_message_unref(error);
+        }
+        return;
+    }
+
+    // The last recorded reply answers any further calls.
+    const RecordedReply recorded = it->size() > 1 ? it->takeFirst() : it->first();
+
+    if (dbus_message_get_no_reply(message))
+        return;
+
+    dbus_message_ref(message);
+    m_pending.append({ now() + scaled(recorded.latency), peer, message, recorded.reply });
+}
+
+void Replay::sendReply(const PendingReply &pending)
+{
+    DBusMessage *recorded = pending.reply->message;
+    DBusMessage *reply = dbus_message_get_type(recorded) == DBUS_MESSAGE_TYPE_ERROR
+            ? dbus_message_new_error(pending.call, dbus_message_get_error_name(recorded), nullptr)
+            : dbus_message_new_method_return(pending.call);
+
+    copyArguments(recorded, reply, m_names);
+    dbus_connection_send(m_peers.at(pending.peer).connection, reply, nullptr);
+
+    dbus_message_unref(reply);
+    dbus_message_unref(pending.call);
+    ++m_replied;
+}
+
+void Replay::changeOwner(DBusMessage *signal)
+{
+    const char *name = nullptr;
+    const char *oldOwner = nullptr;
+    const char *newOwner = nullptr;
+    dbus_message_get_args(signal, nullptr, DBUS_TYPE_STRING, &name, DBUS_TYPE_STRING, &oldOwner,
+                          DBUS_TYPE_STRING, &newOwner, DBUS_TYPE_INVALID);
+
+    DBusConnection *connection = m_peers.at(m_peerByName.value(bytes(name))).connection;
+    DBusError error;
+    dbus_error_init(&error);
+
+    if (*newOwner)
+        dbus_bus_request_name(connection, name, DBUS_NAME_FLAG_DO_NOT_QUEUE, &error);
+    else
+        dbus_bus_release_name(connection, name, &error);
+
+    if (dbus_error_is_set(&error)) {
+        qWarning() << "Cannot change the owner of" << name << error.message;
+        dbus_error_free(&error);
+    }
+}
+
+void Replay::sendRecorded(const Record &record)
+{
+    DBusMessage *recorded = record.message;
+
+    // The bus itself only shows up with the name changes of peers.
+    if (bytes(dbus_message_get_sender(recorded)) == s_busName) {
+        changeOwner(recorded);
+        return;
+    }
+    const QByteArray destination = mapped(dbus_message_get_destination(recorded));
+    DBusMessage *message = nullptr;
+
+    if (dbus_message_get_type(recorded) == DBUS_MESSAGE_TYPE_SIGNAL) {
+        message = dbus_message_new_signal(dbus_message_get_path(recorded),
+                                          dbus_message_get_interface(recorded),
+                                          dbus_message_get_member(recorded));
+        if (!destination.isEmpty())
+            dbus_message_set_destination(message, destination.constData());
+    } else {
+        message = dbus_message_new_method_call(destination.constData(),
+                                               dbus_message_get_path(recorded),
+                                               dbus_message_get_interface(recorded),
+                                               dbus_message_get_member(recorded));
+        // Replies from the bar are read and dropped.
+        dbus_message_set_no_reply(message, dbus_message_get_no_reply(recorded));
+    }
+
+    copyArguments(recorded, message, m_names);
+
+    const int peer = m_peerByName.value(bytes(dbus_message_get_sender(recorded)));
+    dbus_connection_send(m_peers.at(peer).connection, message, nullptr);
+    dbus_message_unref(message);
+    ++m_sent;
+}
+
+qint64 Replay::cpuTime() const
+{
+    QFile file(QString("/proc/%1/stat").arg(m_pid));
+    if (!m_pid || !file.open(QIODevice::ReadOnly))
+        return 0;
+
+    const QByteArray stat = file.readAll();
+    const QList<QByteArray> fields = stat.mid(stat.lastIndexOf(')') + 2).split(' ');
+    if (fields.size() < 13)
+        return 0;
+
+    return (fields.at(11).toLongLong() + fields.at(12).toLongLong()) * 1000 / sysconf(_SC_CLK_TCK);
+}
+
+int Replay::run(int lingerSeconds)
+{
+    m_clock.start();
+
+    const qint64 end = m_scheduled.isEmpty() ? 0 : scaled(m_scheduled.last()->time - m_captureStart);
+    const qint64 timeout = 30 * 1000000LL;
+    int next = 0;
+    qint64 lastOwnerCheck = 0;
+
+    forever {
+        const qint64 time = now();
+
+        // Falls back to the bar's name in case it never calls a peer.
+        if (m_started < 0 && time - lastOwnerCheck > 50000) {
+            lastOwnerCheck = time;
+            DBusConnection *connection = m_peers.first().connection;
+            if (dbus_bus_name_has_owner(connection, "com.cutefish.Statusbar", nullptr)) {
+                DBusMessage *call = dbus_message_new_method_call(s_busName, "/org/freedesktop/DBus", s_busName, "GetNameOwner");
+                const char *name = "com.cutefish.Statusbar";
+                dbus_message_append_args(call, DBUS_TYPE_STRING, &name, DBUS_TYPE_INVALID);
+                DBusMessage *reply = dbus_connection_send_with_reply_and_block(connection, call, 1000, nullptr);
+                const char *owner = nullptr;
+                if (reply && dbus_message_get_args(reply, nullptr, DBUS_TYPE_STRING, &owner, DBUS_TYPE_INVALID))
+                    start(owner);
+                if (reply)
+                    dbus_message_unref(reply);
+                dbus_message_unref(call);
+            } else if (time > timeout) {
+                qCritical() << "The bar did not show up";
+                return 1;
+            }
+        }
+
+        qint64 wait = 50000;
+
+        if (m_started >= 0) {
+            const qint64 elapsed = time - m_started;
+
+            while (next < m_scheduled.size()
+                   && scaled(qMax<qint64>(0, m_scheduled.at(next)->time - m_captureStart)) <= elapsed)
+                sendRecorded(*m_scheduled.at(next++));
+
+            if (next < m_scheduled.size())
+                wait = qMin(wait, scaled(m_scheduled.at(next)->time - m_captureStart) - elapsed);
+
+            if (next == m_scheduled.size() && m_pending.isEmpty()
+                    && elapsed > end + lingerSeconds * 1000000LL)
+                break;
+        }
+
+        for (int i = 0; i < m_pending.size();) {
+            if (m_pending.at(i).due <= time) {
+                sendReply(m_pending.takeAt(i));
+            } else {
+                wait = qMin(wait, m_pending.at(i).due - time);
+                ++i;
+            }
+        }
+
+        for (const Peer &peer : std::as_const(m_peers))
+            dbus_connection_flush(peer.connection);
+
+        QVector<pollfd> fds;
+        for (const Peer &peer : std::as_const(m_peers)) {
+            int fd = -1;
+            dbus_connection_get_unix_fd(peer.connection, &fd);
+            fds.append({ fd, POLLIN, 0 });
+        }
+        poll(fds.data(), fds.size(), int(qMax<qint64>(0, wait) / 1000));
+
+        for (int i = 0; i < m_peers.size(); ++i) {
+            DBusConnection *connection = m_peers.at(i).connection;
+            dbus_connection_read_write(connection, 0);
+
+            while (DBusMessage *message = dbus_connection_pop_message(connection)) {
+                receive(i, message);
+                dbus_message_unref(message);
+            }
+        }
+    }
+
+    m_duration = now() - m_started;
+    m_cpu = cpuTime() - m_cpuStart;
+
+    return 0;
+}
+
+QJsonObject Replay::summary() const
+{
+    const double minutes = m_duration / 60000000.0;
+
+    return QJsonObject {
+        { "speed", m_speed },
+        { "peers", m_peers.size() },
+        { "messagesSent", m_sent },
+        { "repliesSent", m_replied },
+        { "unmatchedCalls", m_unmatched },
+        { "seconds", m_duration / 1000000.0 },
+        { "cpuMs", m_cpu },
+        { "cpuMsPerMinute", minutes > 0 ? m_cpu / minutes : 0 },
+    };
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Replays a DBus capture of cutefish-statusbar");
+    parser.addHelpOption();
+    parser.addPositionalArgument("capture", "pcap file written with CUTEFISH_STATUSBAR_RECORD.");
+
+    QCommandLineOption speedOption("speed", "Playback speed, 0 sends everything at once.", "factor", "1");
+    QCommandLineOption selfOption("self", "Unique name of the bar in the capture.", "name");
+    QCommandLineOption lingerOption("linger", "Seconds to keep answering after the last message.", "s", "5");
+    QCommandLineOption readyOption("ready-file", "Created once the peers own their names.", "file");
+    QCommandLineOption outputOption("output", "Write the JSON results here instead of stdout.", "file");
+    parser.addOptions({ speedOption, selfOption, lingerOption, readyOption, outputOption });
+    parser.process(app);
+
+    if (parser.positionalArguments().size() != 1)
+        parser.showHelp(1);
+
+    const QList<Record> records = readCapture(parser.positionalArguments().first());
+    if (records.isEmpty())
+        return 1;
+
+    Replay replay(records, parser.value(speedOption).toDouble());
+
+    if (!replay.analyze(parser.value(selfOption).toUtf8()) || !replay.connectPeers())
+        return 1;
+
+    if (parser.isSet(readyOption)) {
+        QFile ready(parser.value(readyOption));
+        ready.open(QIODevice::WriteOnly);
+    }
+
+    const int result = replay.run(parser.value(lingerOption).toInt());
+    if (result != 0)
+        return result;
+
+    const QByteArray json = QJsonDocument(replay.summary()).toJson();
+
+    QFile out;
+    if (parser.isSet(outputOption)) {
+        out.setFileName(parser.value(outputOption));
+        if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            qCritical() << "Cannot write" << parser.value(outputOption);
+            return 1;
+        }
+    } else {
+        out.open(stdout, QIODevice::WriteOnly);
+    }
+    out.write(json);
+
+    for (const Record &record : records)
+        dbus_message_unref(record.message);
+
+    return 0;
+}
@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2021 CutefishOS Team.
+ *
+ * Author:     Reion Wong <aj@cutefishos.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+ 
+import QtQuick 6.0
+import cutefish.audio 1.0
+
+// The default PulseAudio sink. The bar's volume icon and the control center
+// slider both read it, so the control center can stay unloaded until opened.
+Item {
+    id: control
+
+    property var defaultSink: paSinkModel.defaultSink
+    property var defaultSinkValue: defaultSink ? defaultSink.volume / 65536.0 * 100.0 : -1
+
+    property var volumeIconName: {
+        if (defaultSinkValue <= 0)
+            return "audio-volume-muted-symbolic"
+        else if (defaultSinkValue <= 25)
+            return "audio-volume-low-symbolic"
+        else if (defaultSinkValue <= 75)
+            return "audio-volume-medium-symbolic"
+        else
+            return "audio-volume-high-symbolic"
+    }
+
+    SinkModel {
+        id: paSinkModel
+    }
+}
@@ -27,7 +27,6 @@ import cutefish.accounts 1.0 as Accounts
 import cutefish.bluez 1.0 as Bluez
 import cutefish.networkmanagement 1.0
 import Cutefish.StatusBar 1.0
-import cutefish.audio 1.0
 import FishUI 1.0 as FishUI
 
 ControlCenterDialog {
@@ -38,26 +37,14 @@ ControlCenterDialog {
 
     property var margin: 4 * Screen.devicePixelRatio
     property point position: Qt.point(0, 0)
-    property var defaultSink: paSinkModel.defaultSink
+    property var defaultSink: audioSink.defaultSink
 
     property bool bluetoothDisConnected: Bluez.Manager.bluetoothBlocked
-    property var defaultSinkValue: defaultSink ? defaultSink.volume / 65536.0 * 100.0 : -1
 
     property var borderColor: windowHelper.compositing ? FishUI.Theme.darkMode ? Qt.rgba(255, 255, 255, 0.3)
                                                                   : Qt.rgba(0, 0, 0, 0.2) : FishUI.Theme.darkMode ? Qt.rgba(255, 255, 255, 0.15)
                                                                                                                   : Qt.rgba(0, 0, 0, 0.15)
 
-    property var volumeIconName: {
-        if (defaultSinkValue <= 0)
-            return "audio-volume-muted-symbolic"
-        else if (defaultSinkValue <= 25)
-            return "audio-volume-low-symbolic"
-        else if (defaultSinkValue <= 75)
-            return "audio-volume-medium-symbolic"
-        else
-            return "audio-volume-high-symbolic"
-    }
-
     onBluetoothDisConnectedChanged: {
         bluetoothItem.checked = !bluetoothDisConnected
     }
@@ -71,24 +58,6 @@ ControlCenterDialog {
     LayoutMirroring.enabled: Qt.application.layoutDirection === Qt.RightToLeft
     LayoutMirroring.childrenInherit: true
 
-    Appearance {
-        id: appearance
-    }
-
-    Notifications {
-        id: notifications
-    }
-
-    SinkModel {
-        id: paSinkModel
-
-        onDefaultSinkChanged: {
-            if (!defaultSink) {
-                return
-            }
-        }
-    }
-
     EnabledConnections {
         id: enabledConnections
     }
@@ -120,10 +89,6 @@ ControlCenterDialog {
         control.y = posY
     }
 
-    Brightness {
-        id: brightness
-    }
-
     Accounts.UserAccount {
         id: currentUser
     }
@@ -193,7 +158,7 @@ ControlCenterDialog {
                     source: "qrc:/images/" + (FishUI.Theme.darkMode ? "dark/" : "light/") + "settings.svg"
                     onLeftButtonClicked: {
                         control.visible = false
-                        process.startDetached("cutefish-settings")
+                        ProcessProvider.startDetached("cutefish-settings")
                     }
                 }
 
@@ -205,7 +170,7 @@ ControlCenterDialog {
 //                    source: "qrc:/images/" + (FishUI.Theme.darkMode ? "dark/" : "light/") + "system-shutdown-symbolic.svg"
 //                    onLeftButtonClicked: {
 //                        control.visible = false
-//                        process.startDetached("cutefish-shutdown")
+//                        ProcessProvider.startDetached("cutefish-shutdown")
 //                    }
 //                }
             }
@@ -257,7 +222,7 @@ ControlCenterDialog {
                     }
                     onPressAndHold: {
                         control.visible = false
-                        process.startDetached("cutefish-settings", ["-m", "wlan"])
+                        ProcessProvider.startDetached("cutefish-settings", ["-m", "wlan"])
                     }
                 }
 
@@ -273,7 +238,7 @@ ControlCenterDialog {
                     onClicked: control.toggleBluetooth()
                     onPressAndHold: {
                         control.visible = false
-                        process.startDetached("cutefish-settings", ["-m", "bluetooth"])
+                        ProcessProvider.startDetached("cutefish-settings", ["-m", "bluetooth"])
                     }
                 }
 
@@ -285,7 +250,7 @@ ControlCenterDialog {
                                                            : "qrc:/images/light/dark-mode.svg"
                     checked: FishUI.Theme.darkMode
                     label: qsTr("Dark Mode")
-                    onClicked: appearance.switchDarkMode(!FishUI.Theme.darkMode)
+                    onClicked: Appearance.switchDarkMode(!FishUI.Theme.darkMode)
                 }
 
                 CardItem {
@@ -293,9 +258,9 @@ ControlCenterDialog {
                     Layout.preferredWidth: cardItems.cellWidth
                     icon: FishUI.Theme.darkMode || checked ? "qrc:/images/dark/do-not-disturb.svg"
                                                            : "qrc:/images/light/do-not-disturb.svg"
-                    checked: notifications.doNotDisturb
+                    checked: Notifications.doNotDisturb
                     label: qsTr("Do Not Disturb")
-                    onClicked: notifications.doNotDisturb = !notifications.doNotDisturb
+                    onClicked: Notifications.doNotDisturb = !Notifications.doNotDisturb
                 }
 
                 CardItem {
@@ -307,7 +272,7 @@ ControlCenterDialog {
                     label: qsTr("Screenshot")
                     onClicked: {
                         control.visible = false
-                        process.startDetached("cutefish-screenshot", ["-d", "500"])
+                        ProcessProvider.startDetached("cutefish-screenshot", ["-d", "500"])
                     }
                 }
             }
@@ -322,7 +287,7 @@ ControlCenterDialog {
             id: brightnessItem
             Layout.fillWidth: true
             height: 40
-            visible: brightness.enabled
+            visible: Brightness.enabled
 
             Rectangle {
                 id: brightnessItemBg
@@ -349,22 +314,15 @@ ControlCenterDialog {
                     antialiasing: true
                 }
 
-                Timer {
-                    id: brightnessTimer
-                    interval: 100
-                    repeat: false
-                    onTriggered: brightness.setValue(brightnessSlider.value)
-                }
-
                 Slider {
                     id: brightnessSlider
                     from: 1
                     to: 100
                     stepSize: 1
-                    value: brightness.value
+                    value: Brightness.value
                     Layout.fillWidth: true
                     Layout.fillHeight: true
-                    onMoved: brightnessTimer.start()
+                    onMoved: Brightness.setValue(brightnessSlider.value)
                 }
 
 //                Label {
@@ -401,7 +359,7 @@ ControlCenterDialog {
                     height: 16
                     width: height
                     sourceSize: Qt.size(width, height)
-                    source: "qrc:/images/" + (FishUI.Theme.darkMode ? "dark" : "light") + "/" + control.volumeIconName + ".svg"
+                    source: "qrc:/images/" + (FishUI.Theme.darkMode ? "dark" : "light") + "/" + audioSink.volumeIconName + ".svg"
                     smooth: false
                     antialiasing: true
                 }
@@ -449,16 +407,7 @@ ControlCenterDialog {
                 id: timeLabel
                 leftPadding: FishUI.Units.smallSpacing / 2
                 color: FishUI.Theme.textColor
-
-                Timer {
-                    interval: 1000
-                    repeat: true
-                    running: true
-                    triggeredOnStart: true
-                    onTriggered: {
-                        timeLabel.text = new Date().toLocaleDateString(Qt.locale(), Locale.LongFormat)
-                    }
-                }
+                text: Clock.date
             }
 
             Item {
@@ -471,13 +420,13 @@ ControlCenterDialog {
 
                 onClicked: {
                     control.visible = false
-                    process.startDetached("cutefish-settings", ["-m", "battery"])
+                    ProcessProvider.startDetached("cutefish-settings", ["-m", "battery"])
                 }
 
                 RowLayout {
                     id: batteryLayout
                     anchors.fill: parent
-                    visible: battery.available
+                    visible: Battery.available
                     spacing: 0
 
                     Image {
@@ -485,7 +434,7 @@ ControlCenterDialog {
                         width: 22
                         height: 16
                         sourceSize: Qt.size(width, height)
-                        source: "qrc:/images/" + (FishUI.Theme.darkMode ? "dark/" : "light/") + battery.iconSource
+                        source: "qrc:/images/" + (FishUI.Theme.darkMode ? "dark/" : "light/") + Battery.iconSource
                         asynchronous: true
                         Layout.alignment: Qt.AlignHCenter | Qt.AlignVCenter
                         antialiasing: true
@@ -493,7 +442,7 @@ ControlCenterDialog {
                     }
 
                     Label {
-                        text: battery.chargePercent + "%"
+                        text: Battery.chargePercent + "%"
                         color: FishUI.Theme.textColor
                         rightPadding: FishUI.Units.smallSpacing / 2
                         Layout.alignment: Qt.AlignHCenter | Qt.AlignVCenter
@@ -141,7 +141,7 @@ ControlCenterDialog {
 
                 onClicked: {
                     control.visible = false
-                    actions.shutdown()
+                    PowerActions.shutdown()
                 }
             }
 
@@ -156,7 +156,7 @@ ControlCenterDialog {
 
                 onClicked: {
                     control.visible = false
-                    actions.reboot()
+                    PowerActions.reboot()
                 }
             }
 
@@ -171,7 +171,7 @@ ControlCenterDialog {
 
                 onClicked: {
                     control.visible = false
-                    actions.logout()
+                    PowerActions.logout()
                 }
             }
 
@@ -186,7 +186,7 @@ ControlCenterDialog {
 
                 onClicked: {
                     control.visible = false
-                    actions.lockScreen()
+                    PowerActions.lockScreen()
                 }
             }
 
@@ -201,16 +201,12 @@ ControlCenterDialog {
 
                 onClicked: {
                     control.visible = false
-                    actions.suspend()
+                    PowerActions.suspend()
                 }
             }
         }
     }
 
-    PowerActions {
-        id: actions
-    }
-
     function adjustCorrectLocation() {
         var posX = control.position.x
         var posY = control.position.y
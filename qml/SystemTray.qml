@@ -1,7 +1,7 @@
 import QtQuick 6.0
 import QtQuick.Layouts 6.0
 import QtQuick.Controls 6.0
-import Qt5Compat.GraphicalEffects 6.0
+import QtQuick.Window 6.0
 
 import Cutefish.StatusBar 1.0
 import FishUI 1.0 as FishUI
@@ -16,15 +16,28 @@ ListView {
     spacing: FishUI.Units.smallSpacing / 2
 
     property real itemWidth: rootItem.iconSize + FishUI.Units.largeSpacing
+    property bool darkMode: rootItem.darkModeAt(x + width / 2)
 
     Layout.fillHeight: true
     Layout.preferredWidth: (itemWidth + (count - 1) * FishUI.Units.smallSpacing) * count
 
     model: SystemTrayModel {
         id: trayModel
+        onMenuOpened: (id, ok) => StatusBar.trayMenuOpened(id, ok)
+    }
+
+    Connections {
+        target: StatusBar
+
+        function onTrayMenuRequested(id) {
+            if (!trayModel.openMenu(id))
+                StatusBar.trayMenuOpened(id, false)
+        }
     }
 
     moveDisplaced: Transition {
+        enabled: EcoMode.animationsEnabled
+
         NumberAnimation {
             properties: "x, y"
             duration: 200
@@ -35,15 +48,13 @@ ListView {
     delegate: StandardItem {
         id: _trayItem
 
-        property bool darkMode: rootItem.darkMode
+        property bool darkMode: trayView.darkMode
         property int dragItemIndex: index
         property bool dragStarted: false
 
         width: trayView.itemWidth
         height: ListView.view.height
-        animationEnabled: true
-
-        onDarkModeChanged: updateTimer.restart()
+        animationEnabled: EcoMode.animationsEnabled
 
         Drag.active: _trayItem.mouseArea.drag.active
         Drag.dragType: Drag.Automatic
@@ -59,15 +70,13 @@ ListView {
             dragStarted = false
         }
 
-        onPositionChanged: {
-            if (_trayItem.mouseArea.pressed) {
-                _trayItem.mouseArea.drag.target = iconItem
-                iconItem.grabToImage(function(result) {
-                    _trayItem.Drag.imageSource = result.url
-                }, { targetSize: Qt.size(iconItem.width, iconItem.height) })
-            } else {
-                _trayItem.mouseArea.drag.target = null
-            }
+        onPressed: {
+            // Reuses the provider's cached pixmap, nothing is rendered per motion event.
+            var source = iconItem.source.toString()
+            _trayItem.Drag.imageSource = source === "" ? ""
+                    : source + (source.indexOf("?") === -1 ? "?" : "&")
+                      + "size=" + Math.round(iconItem.width * Screen.devicePixelRatio)
+            _trayItem.mouseArea.drag.target = iconItem
         }
 
         onReleased: {
@@ -85,32 +94,18 @@ ListView {
             }
         }
 
-        Timer {
-            id: updateTimer
-            interval: 10
-            onTriggered: iconItem.updateIcon()
-        }
-
-        ColorOverlay {
-            id: iconOverlay
-            anchors.centerIn: parent
-            width: rootItem.iconSize
-            height: width
-            source: iconItem
-            color: rootItem.textColor
-            opacity: rootItem.darkMode ? 1 : 0.7
-            visible: model.canColorOverlay
-        }
-
-        FishUI.IconItem {
+        Image {
             id: iconItem
             anchors.centerIn: parent
             width: rootItem.iconSize
             height: width
-            source: model.iconName ? model.iconName : model.icon
-            antialiasing: true
+            sourceSize: Qt.size(width, height)
+            source: model.iconKey ? "image://trayicon/" + model.iconKey
+                                    + (model.canColorOverlay ? (_trayItem.darkMode ? "?color=ffffff" : "?color=000000") : "")
+                                  : ""
+            opacity: model.canColorOverlay && !_trayItem.darkMode ? 0.7 : 1
             smooth: true
-            visible: !dragStarted && !iconOverlay.visible
+            visible: !dragStarted
         }
 
         onClicked: {
@@ -22,7 +22,6 @@ import QtQuick.Layouts 6.0
 import QtQuick.Controls 6.0
 import QtQuick.Window 6.0
 
-import cutefish.networkmanagement 1.0 
 import cutefish.system 1.0 as System
 import Cutefish.StatusBar 1.0
 import FishUI 1.0 as FishUI
@@ -39,10 +38,20 @@ Item {
     property color textColor: rootItem.darkMode ? "#FFFFFF" : "#000000";
     property var fontSize: rootItem.height ? rootItem.height / 3 : 1
 
-    property var timeFormat: StatusBar.twentyFourTime ? "HH:mm" : "h:mm ap"
+    // Wallpaper third under the given x position of the bar.
+    function regionAt(x, count) {
+        var region = Math.floor(x * count / Math.max(1, rootItem.width))
+        return Math.max(0, Math.min(count - 1, region))
+    }
+
+    function darkModeAt(x) {
+        var modes = bgHelper.regionDarkModes
+        return modes[rootItem.regionAt(x, modes.length)]
+    }
 
-    onTimeFormatChanged: {
-        timeTimer.restart()
+    function textColorAt(x) {
+        var colors = bgHelper.regionTextColors
+        return colors[rootItem.regionAt(x, colors.length)]
     }
 
     System.Wallpaper {
@@ -100,7 +109,7 @@ Item {
 
         MenuItem {
             text: qsTr("Close")
-            onTriggered: acticity.close()
+            onTriggered: Activity.close()
         }
     }
 
@@ -114,7 +123,8 @@ Item {
         // App name
         StandardItem {
             id: acticityItem
-            animationEnabled: true
+            property bool darkMode: rootItem.darkModeAt(x + width / 2)
+            animationEnabled: EcoMode.animationsEnabled
             Layout.fillHeight: true
             Layout.preferredWidth: Math.min(rootItem.width / 3,
                                             acticityLayout.implicitWidth + FishUI.Units.largeSpacing)
@@ -136,7 +146,7 @@ Item {
                     height: rootItem.iconSize
                     sourceSize: Qt.size(rootItem.iconSize,
                                         rootItem.iconSize)
-                    source: acticity.icon ? "image://icontheme/" + acticity.icon : ""
+                    source: Activity.icon ? "image://icontheme/" + Activity.icon : ""
                     visible: status === Image.Ready
                     antialiasing: true
                     smooth: false
@@ -144,10 +154,10 @@ Item {
 
                 Label {
                     id: acticityLabel
-                    text: acticity.title
+                    text: Activity.title
                     Layout.fillWidth: true
                     elide: Qt.ElideRight
-                    color: rootItem.textColor
+                    color: acticityItem.darkMode ? "#FFFFFF" : "#000000"
                     visible: text
                     Layout.alignment: Qt.AlignVCenter
                     font.pointSize: rootItem.fontSize
@@ -195,7 +205,7 @@ Item {
                     Text {
                         id: _actionText
                         anchors.centerIn: parent
-                        color: rootItem.textColor
+                        color: rootItem.textColorAt(appMenuItem.x + _menuItem.x + _menuItem.width / 2)
                         font.pointSize: rootItem.fontSize
                         text: {
                             var text = activeMenu
@@ -255,9 +265,10 @@ Item {
 
         StandardItem {
             id: controler
+            property bool darkMode: rootItem.darkModeAt(x + width / 2)
 
-            checked: controlCenter.item.visible
-            animationEnabled: true
+            checked: controlCenter.item ? controlCenter.item.visible : false
+            animationEnabled: EcoMode.animationsEnabled
             Layout.fillHeight: true
             Layout.preferredWidth: _controlerLayout.implicitWidth + FishUI.Units.largeSpacing
 
@@ -266,6 +277,12 @@ Item {
             }
 
             function toggleDialog() {
+                if (!controlCenter.item) {
+                    controlCenter.openWhenLoaded = true
+                    controlCenter.active = true
+                    return
+                }
+
                 if (controlCenter.item.visible)
                     controlCenter.item.close()
                 else {
@@ -286,8 +303,8 @@ Item {
 
                 Image {
                     id: volumeIcon
-                    visible: controlCenter.item.defaultSink
-                    source: "qrc:/images/" + (rootItem.darkMode ? "dark/" : "light/") + controlCenter.item.volumeIconName + ".svg"
+                    visible: audioSink.defaultSink
+                    source: "qrc:/images/" + (controler.darkMode ? "dark/" : "light/") + audioSink.volumeIconName + ".svg"
                     width: rootItem.iconSize
                     height: width
                     sourceSize: Qt.size(width, height)
@@ -315,24 +332,24 @@ Item {
 
                 // Battery Item
                 RowLayout {
-                    visible: battery.available
+                    visible: Battery.available
 
                     Image {
                         id: batteryIcon
                         height: rootItem.iconSize
                         width: height + 6
                         sourceSize: Qt.size(width, height)
-                        source: "qrc:/images/" + (rootItem.darkMode ? "dark/" : "light/") + battery.iconSource
+                        source: "qrc:/images/" + (controler.darkMode ? "dark/" : "light/") + Battery.iconSource
                         Layout.alignment: Qt.AlignCenter
                         antialiasing: true
                         smooth: false
                     }
 
                     Label {
-                        text: battery.chargePercent + "%"
+                        text: Battery.chargePercent + "%"
                         font.pointSize: rootItem.fontSize
-                        color: rootItem.textColor
-                        visible: battery.showPercentage
+                        color: controler.darkMode ? "#FFFFFF" : "#000000"
+                        visible: Battery.showPercentage
                     }
                 }
             }
@@ -340,13 +357,20 @@ Item {
 
         StandardItem {
             id: shutdownItem
+            property bool darkMode: rootItem.darkModeAt(x + width / 2)
 
-            animationEnabled: true
+            animationEnabled: EcoMode.animationsEnabled
             Layout.fillHeight: true
             Layout.preferredWidth: shutdownIcon.implicitWidth + FishUI.Units.smallSpacing
-            checked: shutdownDialog.item.visible
+            checked: shutdownDialog.item ? shutdownDialog.item.visible : false
 
             onClicked: {
+                if (!shutdownDialog.item) {
+                    shutdownDialog.openWhenLoaded = true
+                    shutdownDialog.active = true
+                    return
+                }
+
                 shutdownDialog.item.position = Qt.point(0, 0)
                 shutdownDialog.item.position = mapToGlobal(0, 0)
                 shutdownDialog.item.open()
@@ -358,7 +382,7 @@ Item {
                 width: rootItem.iconSize
                 height: width
                 sourceSize: Qt.size(width, height)
-                source: "qrc:/images/" + (rootItem.darkMode ? "dark/" : "light/") + "system-shutdown-symbolic.svg"
+                source: "qrc:/images/" + (shutdownItem.darkMode ? "dark/" : "light/") + "system-shutdown-symbolic.svg"
                 asynchronous: true
                 antialiasing: true
                 smooth: false
@@ -368,13 +392,14 @@ Item {
         // Pop-up notification center and calendar
         StandardItem {
             id: datetimeItem
+            property bool darkMode: rootItem.darkModeAt(x + width / 2)
 
-            animationEnabled: true
+            animationEnabled: EcoMode.animationsEnabled
             Layout.fillHeight: true
             Layout.preferredWidth: _dateTimeLayout.implicitWidth + FishUI.Units.smallSpacing
 
             onClicked: {
-                process.startDetached("cutefish-notificationd", ["-s"])
+                ProcessProvider.startDetached("cutefish-notificationd", ["-s"])
             }
 
             RowLayout {
@@ -396,19 +421,8 @@ Item {
                     id: timeLabel
                     Layout.alignment: Qt.AlignCenter
                     font.pointSize: rootItem.fontSize
-                    color: rootItem.textColor
-
-                    Timer {
-                        id: timeTimer
-                        interval: 1000
-                        repeat: true
-                        running: true
-                        triggeredOnStart: true
-                        onTriggered: {
-                            timeLabel.text = new Date().toLocaleTimeString(Qt.locale(), StatusBar.twentyFourTime ? rootItem.timeFormat
-                                                                                                                 : Locale.ShortFormat)
-                        }
-                    }
+                    color: datetimeItem.darkMode ? "#FFFFFF" : "#000000"
+                    text: Clock.time
                 }
             }
         }
@@ -426,7 +440,7 @@ Item {
         onActivatedChanged: {
             // TODO
             // if (activated)
-            //     acticity.move()
+            //     Activity.move()
         }
 
         onPressed: {
@@ -438,7 +452,7 @@ Item {
         }
 
         onDoubleClicked: {
-            acticity.toggleMaximize()
+            Activity.toggleMaximize()
         }
 
         onMouseYChanged: {
@@ -460,17 +474,71 @@ Item {
         }
     }
 
+    // Frame time debug overlay, see FrameStatistics.
+    Rectangle {
+        anchors.centerIn: parent
+        width: _frameLabel.implicitWidth + FishUI.Units.smallSpacing * 2
+        height: parent.height
+        color: "#CC000000"
+        visible: FrameStatistics.overlayEnabled
+
+        Label {
+            id: _frameLabel
+            anchors.centerIn: parent
+            text: FrameStatistics.summary
+            color: "#FFFFFF"
+            font.pointSize: rootItem.fontSize
+        }
+    }
+
+    AudioSink {
+        id: audioSink
+    }
+
     // Components
+    // Created on first open, or ahead of time when prewarming is configured.
+    // They stay resident once loaded. Loaded by URL so their types and plugin
+    // imports are not resolved while main.qml is compiled.
     Loader {
         id: controlCenter
-        sourceComponent: ControlCenter {}
-        asynchronous: true
+        property bool openWhenLoaded: false
+        active: false
+        asynchronous: !openWhenLoaded
+        source: "ControlCenter.qml"
+
+        onLoaded: {
+            StatusBar.componentLoaded("ControlCenter")
+
+            if (openWhenLoaded) {
+                openWhenLoaded = false
+                controler.toggleDialog()
+            }
+        }
     }
 
     Loader {
         id: shutdownDialog
-        sourceComponent: ShutdownDialog {}
-        asynchronous: true
+        property bool openWhenLoaded: false
+        active: false
+        asynchronous: !openWhenLoaded
+        source: "ShutdownDialog.qml"
+
+        onLoaded: {
+            StatusBar.componentLoaded("ShutdownDialog")
+
+            if (openWhenLoaded) {
+                openWhenLoaded = false
+                shutdownItem.clicked(null)
+            }
+        }
     }
 
+    Connections {
+        target: StatusBar
+
+        function onPrewarmRequested() {
+            controlCenter.active = true
+            shutdownDialog.active = true
+        }
+    }
 }
@@ -18,6 +18,7 @@
  */
 
 #include "activity.h"
+#include "windowinfocache.h"
 
 #include <QFile>
 #include <QCursor>
@@ -30,7 +31,6 @@
 #include <NETWM>
 #include <KWindowEffects>
 #include <KX11Extras>                      // KF6 X11 API
-#include <KWindowInfo>
 #include <KWindowSystem>
 
 static const QStringList blockList = {
@@ -38,20 +38,48 @@ static const QStringList blockList = {
     "cutefish-statusbar"
 };
 
+// Only these properties of the active window affect what we show.
+static const NET::Properties s_watchedProperties = NET::WMName | NET::WMVisibleName | NET::WMState | NET::WMWindowType;
+static const NET::Properties2 s_watchedProperties2 = NET::WM2WindowClass;
+
+static Activity *SELF = nullptr;
+
+Activity *Activity::self()
+{
+    if (!SELF)
+        SELF = new Activity;
+
+    return SELF;
+}
+
+Activity *Activity::create(QQmlEngine *, QJSEngine *)
+{
+    // Shared with the C++ side, the engine must not take ownership.
+    QJSEngine::setObjectOwnership(self(), QJSEngine::CppOwnership);
+    return self();
+}
+
 Activity::Activity(QObject *parent)
     : QObject(parent)
     , m_cApps(CApplications::self())
+    , m_pid(0)
+    , m_launchPad(false)
 {
+    // Bursts of property changes are evaluated at most once per frame.
+    m_updateTimer.setSingleShot(true);
+    m_updateTimer.setInterval(16);
+    connect(&m_updateTimer, &QTimer::timeout, this, &Activity::onActiveWindowChanged);
+
 #ifdef KWS_X11
     onActiveWindowChanged();
 
-    connect(KWindowSystem::self(), &KWindowSystem::activeWindowChanged,
-            this, &Activity::onActiveWindowChanged);
+    connect(KX11Extras::self(), &KX11Extras::activeWindowChanged,
+            this, &Activity::scheduleUpdate);
 
-    connect(KWindowSystem::self(),
-            static_cast<void (KWindowSystem::*)(WId, NET::Properties, NET::Properties2)>
-            (&KWindowSystem::windowChanged),
-            this, &Activity::onActiveWindowChanged);
+    connect(KX11Extras::self(),
+            static_cast<void (KX11Extras::*)(WId, NET::Properties, NET::Properties2)>
+            (&KX11Extras::windowChanged),
+            this, &Activity::onWindowChanged);
 #endif
 }
 
@@ -104,10 +132,10 @@ void Activity::maximize()
 void Activity::toggleMaximize()
 {
 #ifdef KWS_X11
-    KWindowInfo info(KWindowSystem::activeWindow(), NET::WMState);
+    WindowInfo info = WindowInfoCache::self()->info(KWindowSystem::activeWindow());
     bool isWindow = !info.hasState(NET::SkipTaskbar) ||
-                    info.windowType(NET::UtilityMask) != NET::Utility ||
-                    info.windowType(NET::DesktopMask) != NET::Desktop;
+                    info.windowType != NET::Utility ||
+                    info.windowType != NET::Desktop;
 
     if (!isWindow)
         return;
@@ -121,15 +149,15 @@ void Activity::move()
 {
 #ifdef KWS_X11
     WId winId = KWindowSystem::activeWindow();
-    KWindowInfo info(winId, NET::WMState | NET::WMGeometry | NET::WMDesktop);
+    WindowInfo info = WindowInfoCache::self()->info(winId);
     bool isWindow = !info.hasState(NET::SkipTaskbar) ||
-                    info.windowType(NET::UtilityMask) != NET::Utility ||
-                    info.windowType(NET::DesktopMask) != NET::Desktop;
+                    info.windowType != NET::Utility ||
+                    info.windowType != NET::Desktop;
 
     if (!isWindow) return;
 
-    if (!info.isOnCurrentDesktop()) {
-        KX11Extras::setCurrentDesktop(info.desktop());
+    if (info.desktop != NET::OnAllDesktops && info.desktop != KX11Extras::currentDesktop()) {
+        KX11Extras::setCurrentDesktop(info.desktop);
         KX11Extras::forceActiveWindow(winId);
     }
 
@@ -157,13 +185,12 @@ bool Activity::isAcceptableWindow(quint64 wid)
     ignoreList |= NET::PopupMenuMask;
     ignoreList |= NET::NotificationMask;
 
-    KWindowInfo info(wid, NET::WMWindowType | NET::WMState,
-                     NET::WM2TransientFor | NET::WM2WindowClass);
+    WindowInfo info = WindowInfoCache::self()->info(wid);
 
-    if (!info.valid())
+    if (!info.valid)
         return false;
 
-    if (NET::typeMatchesMask(info.windowType(NET::AllTypesMask), ignoreList))
+    if (NET::typeMatchesMask(info.windowType, ignoreList))
         return false;
 
     if (info.hasState(NET::SkipTaskbar) || info.hasState(NET::SkipPager))
@@ -176,18 +203,18 @@ bool Activity::isAcceptableWindow(quint64 wid)
         // root will remain 0 and transientFor checks fall back accordingly.
     }
 
-    WId trans = info.transientFor();
+    WId trans = info.transientFor;
     if (trans == 0 || trans == wid || trans == root)
         return true;
 
-    info = KWindowInfo(trans, NET::WMWindowType);
+    info = WindowInfoCache::self()->info(trans);
 
     QFlags<NET::WindowTypeMask> normal;
     normal |= NET::NormalMask;
     normal |= NET::DialogMask;
     normal |= NET::UtilityMask;
 
-    return !NET::typeMatchesMask(info.windowType(NET::AllTypesMask), normal);
+    return !NET::typeMatchesMask(info.windowType, normal);
 #else
     Q_UNUSED(wid)
     return false;
@@ -197,59 +224,92 @@ bool Activity::isAcceptableWindow(quint64 wid)
 void Activity::onActiveWindowChanged()
 {
 #ifdef KWS_X11
-    KWindowInfo info(KWindowSystem::activeWindow(),
-                     NET::WMState | NET::WMVisibleName | NET::WMWindowType,
-                     NET::WM2WindowClass);
+    const WId activeWindow = KWindowSystem::activeWindow();
+    WindowInfo info = WindowInfoCache::self()->info(activeWindow);
 
-    m_launchPad = (info.windowClassClass() == "cutefish-launcher");
-    emit launchPadChanged();
+    setLaunchPad(info.windowClassClass == "cutefish-launcher");
 
-    if (NET::typeMatchesMask(info.windowType(NET::AllTypesMask), NET::DesktopMask)) {
-        m_title = tr("Desktop");
-        m_icon.clear();
-        emit titleChanged();
-        emit iconChanged();
+    if (NET::typeMatchesMask(info.windowType, NET::DesktopMask)) {
+        setTitle(tr("Desktop"));
+        setIcon(QString());
         return;
     }
 
-    if (!isAcceptableWindow(KWindowSystem::activeWindow()) ||
-        blockList.contains(info.windowClassClass())) {
+    if (!isAcceptableWindow(activeWindow) ||
+        blockList.contains(info.windowClassClass)) {
         clearTitle();
         clearIcon();
         return;
     }
 
-    m_pid = info.pid();
-    m_windowClass = info.windowClassClass().toLower();
+    m_pid = info.pid;
+    m_windowClass = info.windowClassClass.toLower();
 
     CAppItem *item = m_cApps->matchItem(m_pid, m_windowClass);
     if (item) {
-        m_title = item->localName;
-        emit titleChanged();
-
-        if (m_icon != item->icon) {
-            m_icon = item->icon;
-            emit iconChanged();
-        }
+        setTitle(item->localName);
+        setIcon(item->icon);
     } else {
-        QString t = info.visibleName();
-        if (t != m_title) {
-            m_title = t;
-            emit titleChanged();
-            clearIcon();
-        }
+        setTitle(info.visibleName);
+        setIcon(QString());
     }
 #endif
 }
 
+void Activity::onWindowChanged(WId id, NET::Properties properties, NET::Properties2 properties2)
+{
+#ifdef KWS_X11
+    // Background windows rewriting their titles are none of our business.
+    if (id != KX11Extras::activeWindow())
+        return;
+
+    if (!(properties & s_watchedProperties) && !(properties2 & s_watchedProperties2))
+        return;
+
+    scheduleUpdate();
+#else
+    Q_UNUSED(id)
+    Q_UNUSED(properties)
+    Q_UNUSED(properties2)
+#endif
+}
+
+void Activity::scheduleUpdate()
+{
+    if (!m_updateTimer.isActive())
+        m_updateTimer.start();
+}
+
 void Activity::clearTitle()
 {
-    m_title.clear();
-    emit titleChanged();
+    setTitle(QString());
 }
 
 void Activity::clearIcon()
 {
-    m_icon.clear();
-    emit iconChanged();
+    setIcon(QString());
+}
+
+void Activity::setLaunchPad(bool launchPad)
+{
+    if (m_launchPad != launchPad) {
+        m_launchPad = launchPad;
+        emit launchPadChanged();
+    }
+}
+
+void Activity::setTitle(const QString &title)
+{
+    if (m_title != title) {
+        m_title = title;
+        emit titleChanged();
+    }
+}
+
+void Activity::setIcon(const QString &icon)
+{
+    if (m_icon != icon) {
+        m_icon = icon;
+        emit iconChanged();
+    }
 }
@@ -21,16 +21,24 @@
 #define ACTIVITY_H
 
 #include <QObject>
+#include <QTimer>
+#include <QQmlEngine>
+#include <NETWM>
 #include "capplications.h"
 
 class Activity : public QObject
 {
     Q_OBJECT
+    QML_ELEMENT
+    QML_SINGLETON
     Q_PROPERTY(QString title READ title NOTIFY titleChanged)
     Q_PROPERTY(QString icon READ icon NOTIFY iconChanged)
     Q_PROPERTY(bool launchPad READ launchPad NOTIFY launchPadChanged)
 
 public:
+    static Activity *self();
+    static Activity *create(QQmlEngine *, QJSEngine *);
+
     explicit Activity(QObject *parent = nullptr);
 
     bool launchPad() const;
@@ -49,10 +57,17 @@ public:
 
 private slots:
     void onActiveWindowChanged();
+    void onWindowChanged(WId id, NET::Properties properties, NET::Properties2 properties2);
+    void scheduleUpdate();
 
     void clearTitle();
     void clearIcon();
 
+private:
+    void setLaunchPad(bool launchPad);
+    void setTitle(const QString &title);
+    void setIcon(const QString &icon);
+
 signals:
     void titleChanged();
     void iconChanged();
@@ -60,6 +75,7 @@ signals:
 
 private:
     CApplications *m_cApps;
+    QTimer m_updateTimer;
     QString m_title;
     QString m_icon;
     QString m_windowClass;
@@ -20,17 +20,32 @@
 #include "appearance.h"
 
 #include <QDBusConnection>
-#include <QDBusInterface>
-#include <QDBusReply>
 #include <QDBusServiceWatcher>
 #include <QDBusPendingCall>
 
+static Appearance *SELF = nullptr;
+
+Appearance *Appearance::self()
+{
+    if (!SELF)
+        SELF = new Appearance;
+
+    return SELF;
+}
+
+Appearance *Appearance::create(QQmlEngine *, QJSEngine *)
+{
+    // Shared with the C++ side, the engine must not take ownership.
+    QJSEngine::setObjectOwnership(self(), QJSEngine::CppOwnership);
+    return self();
+}
+
 Appearance::Appearance(QObject *parent)
     : QObject(parent)
-    , m_interface("com.cutefish.Settings",
-                  "/Theme",
-                  "com.cutefish.Theme",
-                  QDBusConnection::sessionBus())
+    , m_properties("com.cutefish.Settings",
+                   "/Theme",
+                   "com.cutefish.Theme",
+                   QDBusConnection::sessionBus())
     , m_dockSettings(new QSettings(QSettings::UserScope, "cutefishos", "dock"))
     , m_dockConfigWacher(new QFileSystemWatcher(this))
     , m_dockIconSize(0)
@@ -50,29 +65,25 @@ Appearance::Appearance(QObject *parent)
         emit dockDirectionChanged();
     });
 
-    // Init
-    if (m_interface.isValid()) {
-        m_fontPointSize = m_interface.property("systemFontPointSize").toInt();
-
-        connect(&m_interface, SIGNAL(darkModeDimsWallpaperChanged()), this, SIGNAL(dimsWallpaperChanged()));
-    }
+    m_properties.watchSignal("darkModeDimsWallpaperChanged", "darkModeDimsWallpaper");
+    m_properties.watchSignal("devicePixelRatioChanged", "devicePixelRatio");
+    m_properties.watchSignal("systemFontPointSizeChanged", "systemFontPointSize");
+    connect(&m_properties, &DBusPropertyCache::propertyChanged, this, &Appearance::onPropertyChanged);
 }
 
 void Appearance::switchDarkMode(bool darkMode)
 {
-    if (m_interface.isValid()) {
-        m_interface.call("setDarkMode", darkMode);
-    }
+    m_properties.asyncCall("setDarkMode", { darkMode });
 }
 
 bool Appearance::dimsWallpaper() const
 {
-    return m_interface.property("darkModeDimsWallpaper").toBool();
+    return m_properties.value("darkModeDimsWallpaper").toBool();
 }
 
 void Appearance::setDimsWallpaper(bool value)
 {
-    m_interface.call("setDarkModeDimsWallpaper", value);
+    m_properties.asyncCall("setDarkModeDimsWallpaper", { value });
 }
 
 int Appearance::dockIconSize() const
@@ -108,13 +119,7 @@ void Appearance::setGenericFontFamily(const QString &name)
     if (name.isEmpty())
         return;
 
-    QDBusInterface iface("com.cutefish.Settings",
-                         "/Theme",
-                         "com.cutefish.Theme",
-                         QDBusConnection::sessionBus(), this);
-    if (iface.isValid()) {
-        iface.call("setSystemFont", name);
-    }
+    m_properties.asyncCall("setSystemFont", { name });
 }
 
 void Appearance::setFixedFontFamily(const QString &name)
@@ -122,13 +127,7 @@ void Appearance::setFixedFontFamily(const QString &name)
     if (name.isEmpty())
         return;
 
-    QDBusInterface iface("com.cutefish.Settings",
-                         "/Theme",
-                         "com.cutefish.Theme",
-                         QDBusConnection::sessionBus(), this);
-    if (iface.isValid()) {
-        iface.call("setSystemFixedFont", name);
-    }
+    m_properties.asyncCall("setSystemFixedFont", { name });
 }
 
 int Appearance::fontPointSize() const
@@ -140,38 +139,34 @@ void Appearance::setFontPointSize(int fontPointSize)
 {
     m_fontPointSize = fontPointSize;
 
-    QDBusInterface iface("com.cutefish.Settings",
-                         "/Theme",
-                         "com.cutefish.Theme",
-                         QDBusConnection::sessionBus(), this);
-    if (iface.isValid()) {
-        iface.call("setSystemFontPointSize", m_fontPointSize * 1.0);
-    }
+    m_properties.asyncCall("setSystemFontPointSize", { m_fontPointSize * 1.0 });
 }
 
 void Appearance::setAccentColor(int accentColor)
 {
-    QDBusInterface iface("com.cutefish.Settings",
-                         "/Theme",
-                         "com.cutefish.Theme",
-                         QDBusConnection::sessionBus(), this);
-    if (iface.isValid()) {
-        iface.call("setAccentColor", accentColor);
-    }
+    m_properties.asyncCall("setAccentColor", { accentColor });
 }
 
 double Appearance::devicePixelRatio() const
 {
-    return m_interface.property("devicePixelRatio").toDouble();
+    return m_properties.value("devicePixelRatio", 1.0).toDouble();
 }
 
 void Appearance::setDevicePixelRatio(double value)
 {
-    QDBusInterface iface("com.cutefish.Settings",
-                         "/Theme",
-                         "com.cutefish.Theme",
-                         QDBusConnection::sessionBus(), this);
-    if (iface.isValid()) {
-        iface.call("setDevicePixelRatio", value);
+    m_properties.asyncCall("setDevicePixelRatio", { value });
+}
+
+void Appearance::onPropertyChanged(const QString &name, const QVariant &value)
+{
+    if (name == "darkModeDimsWallpaper") {
+        emit dimsWallpaperChanged();
+    } else if (name == "devicePixelRatio") {
+        emit devicePixelRatioChanged();
+    } else if (name == "systemFontPointSize") {
+        if (m_fontPointSize != value.toInt()) {
+            m_fontPointSize = value.toInt();
+            emit fontPointSizeChanged();
+        }
     }
 }
@@ -23,11 +23,15 @@
 #include <QObject>
 #include <QSettings>
 #include <QFileSystemWatcher>
-#include <QDBusInterface>
+#include <QQmlEngine>
+
+#include "dbuspropertycache.h"
 
 class Appearance : public QObject
 {
     Q_OBJECT
+    QML_ELEMENT
+    QML_SINGLETON
     Q_PROPERTY(int dockIconSize READ dockIconSize WRITE setDockIconSize NOTIFY dockIconSizeChanged)
     Q_PROPERTY(int dockDirection READ dockDirection WRITE setDockDirection NOTIFY dockDirectionChanged)
     Q_PROPERTY(int fontPointSize READ fontPointSize WRITE setFontPointSize NOTIFY fontPointSizeChanged)
@@ -35,6 +39,9 @@ class Appearance : public QObject
     Q_PROPERTY(double devicePixelRatio READ devicePixelRatio WRITE setDevicePixelRatio NOTIFY devicePixelRatioChanged)
 
 public:
+    static Appearance *self();
+    static Appearance *create(QQmlEngine *, QJSEngine *);
+
     explicit Appearance(QObject *parent = nullptr);
 
     Q_INVOKABLE void switchDarkMode(bool darkMode);
@@ -66,8 +73,11 @@ signals:
     void dimsWallpaperChanged();
     void devicePixelRatioChanged();
 
+private slots:
+    void onPropertyChanged(const QString &name, const QVariant &value);
+
 private:
-    QDBusInterface m_interface;
+    DBusPropertyCache m_properties;
     QSettings *m_dockSettings;
     QFileSystemWatcher *m_dockConfigWacher;
 
@@ -26,8 +26,11 @@
 #include "appmenudbus.h"
 #include "appmenuadaptor.h"
 #include "kdbusimporter.h"
+#include "../dbusmenuregistry.h"
 #include "menuimporteradaptor.h"
 #include "verticalmenu.h"
+#include "../windowinfocache.h"
+#include "../stallwatchdog.h"
 
 // Qt
 #include <QApplication>
@@ -46,6 +49,10 @@ AppMenu::AppMenu(QObject *parent)
     : QObject(parent)
 //    , m_appmenuDBus(new AppmenuDBus(this))
 {
+    m_pendingTimeout.setSingleShot(true);
+    m_pendingTimeout.setInterval(5000);
+    connect(&m_pendingTimeout, &QTimer::timeout, this, &AppMenu::releasePendingImporter);
+
     reconfigure();
 
 //    m_appmenuDBus->connectToBus();
@@ -108,6 +115,8 @@ AppMenu::AppMenu(QObject *parent)
 
 AppMenu::~AppMenu()
 {
+    releasePendingImporter();
+
 #ifdef Q_OS_LINUX
     if (m_xcbConn) {
         xcb_disconnect(m_xcbConn);
@@ -139,6 +148,8 @@ void AppMenu::slotWindowRegistered(WId id, const QString &serviceName, const QDB
     static xcb_atom_t s_objectPathAtom = XCB_ATOM_NONE;
 
     auto setWindowProperty = [this](WId id, xcb_atom_t &atom, const QByteArray &name, const QByteArray &value) {
+        BlockingSection section("x11", QString::fromLatin1("ChangeProperty " + name));
+
         if (atom == XCB_ATOM_NONE) {
             const xcb_intern_atom_cookie_t cookie = xcb_intern_atom(m_xcbConn, false, name.length(), name.constData());
             QScopedPointer<xcb_intern_atom_reply_t, QScopedPointerPodDeleter> reply(xcb_intern_atom_reply(m_xcbConn, cookie, nullptr));
@@ -164,6 +175,9 @@ void AppMenu::slotWindowRegistered(WId id, const QString &serviceName, const QDB
 
     setWindowProperty(id, s_serviceNameAtom, s_x11AppMenuServiceNamePropertyName, serviceName.toUtf8());
     setWindowProperty(id, s_objectPathAtom, s_x11AppMenuObjectPathPropertyName, menuObjectPath.path().toUtf8());
+
+    // Spare the model a round trip to read back what we just wrote.
+    WindowInfoCache::self()->setAppMenu(id, serviceName, menuObjectPath.path());
 #endif
 }
 
@@ -186,15 +200,20 @@ void AppMenu::slotShowMenu(int x, int y, const QString &serviceName, const QDBus
         return;
     }
 
-    auto *importer = new KDBusMenuImporter(serviceName, menuObjectPath.path(), this);
-    QMetaObject::invokeMethod(importer, "updateMenu", Qt::QueuedConnection);
-    disconnect(importer, nullptr, this, nullptr); // ensure we don't popup multiple times in case the menu updates again later
+    // A newer request supersedes one still waiting for its layout.
+    releasePendingImporter();
 
-    connect(importer, &KDBusMenuImporter::menuUpdated, this, [=](QMenu *m) {
-        QMenu *menu = importer->menu();
-        if (!menu || menu != m) {
-            return;
+    auto *importer = DBusMenuRegistry::self()->acquire<KDBusMenuImporter>(serviceName, menuObjectPath.path());
+
+    auto popup = [=] {
+        // ensure we don't popup multiple times in case the menu updates again later
+        disconnect(importer, &DBusMenuImporter::menuUpdated, this, nullptr);
+        if (m_pendingImporter == importer) {
+            m_pendingTimeout.stop();
+            m_pendingImporter = nullptr;
         }
+
+        QMenu *menu = importer->menu();
         m_menu = qobject_cast<VerticalMenu *>(menu);
 
         m_menu.data()->setServiceName(serviceName);
@@ -202,7 +221,9 @@ void AppMenu::slotShowMenu(int x, int y, const QString &serviceName, const QDBus
 
         connect(m_menu.data(), &QMenu::aboutToHide, this, [this, importer] {
             hideMenu();
-            importer->deleteLater();
+            disconnect(importer, nullptr, this, nullptr);
+            disconnect(importer->menu(), &QMenu::aboutToHide, this, nullptr);
+            DBusMenuRegistry::self()->release(importer);
         });
 
 //        if (m_plasmashell) {
@@ -219,7 +240,35 @@ void AppMenu::slotShowMenu(int x, int y, const QString &serviceName, const QDBus
         if (actiontoActivate) {
             m_menu.data()->setActiveAction(actiontoActivate);
         }
+    };
+
+    // Shown again while the registry still had it, no round trip needed.
+    if (DBusMenuRegistry::isWarm(importer)) {
+        popup();
+        return;
+    }
+
+    m_pendingImporter = importer;
+    m_pendingTimeout.start();
+
+    connect(importer, &KDBusMenuImporter::menuUpdated, this, [=](QMenu *m) {
+        if (m == importer->menu()) {
+            popup();
+        }
     });
+    QMetaObject::invokeMethod(importer, "updateMenu", Qt::QueuedConnection);
+}
+
+void AppMenu::releasePendingImporter()
+{
+    m_pendingTimeout.stop();
+
+    if (!m_pendingImporter)
+        return;
+
+    disconnect(m_pendingImporter, &DBusMenuImporter::menuUpdated, this, nullptr);
+    DBusMenuRegistry::self()->release(m_pendingImporter);
+    m_pendingImporter = nullptr;
 }
 
 void AppMenu::reconfigure()
@@ -30,6 +30,7 @@
 
 #include "menuimporter.h"
 #include <QPointer>
+#include <QTimer>
 
 class QDBusServiceWatcher;
 class KDBusMenuImporter;
@@ -85,6 +86,7 @@ private Q_SLOTS:
 
 private:
     void hideMenu();
+    void releasePendingImporter();
 
     void fakeUnityAboutToShow(const QString &service, const QDBusObjectPath &menuObjectPath);
 
@@ -95,6 +97,11 @@ private:
     QDBusServiceWatcher *m_menuViewWatcher;
     QPointer<VerticalMenu> m_menu;
     xcb_connection_t *m_xcbConn = nullptr;
+
+    // Acquired for a menu that waits for its layout, released when another
+    // menu is requested or the layout does not arrive in time.
+    KDBusMenuImporter *m_pendingImporter = nullptr;
+    QTimer m_pendingTimeout;
 };
 
 #endif // APPMENU_H
@@ -139,6 +139,8 @@ void AppMenuApplet::trigger(QQuickItem *ctx, int idx)
         // Top
         pos.setY(pos.y() + ctx->height() + 6);
 
+        // Submenus are filled lazily, size the actions that will be shown.
+        m_model->populateMenu(actionMenu);
         actionMenu->adjustSize();
 
         pos = QPoint(qBound(geo.x(), pos.x(), geo.x() + geo.width() - actionMenu->width()),
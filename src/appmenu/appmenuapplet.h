@@ -27,12 +27,14 @@
 #include <QQuickItem>
 #include <QPointer>
 #include <QMenu>
+#include <QQmlEngine>
 
 #include "appmenumodel.h"
 
 class AppMenuApplet : public QObject
 {
     Q_OBJECT
+    QML_ELEMENT
     Q_PROPERTY(AppMenuModel *model READ model WRITE setModel NOTIFY modelChanged)
     Q_PROPERTY(int currentIndex READ currentIndex NOTIFY currentIndexChanged)
     Q_PROPERTY(QQuickItem *buttonGrid READ buttonGrid WRITE setButtonGrid NOTIFY buttonGridChanged)
@@ -30,119 +30,13 @@
 #include <QDBusServiceWatcher>
 #include <QGuiApplication>
 #include <QMenu>
-#include <QTimer>
 #include <QDebug>
 
+#include <KX11Extras>
 
 #include "../libdbusmenuqt/dbusmenuimporter.h"
-
-#include <xcb/xcb.h>
-#include <xcb/xproto.h>
-
-/*
- * Helper: get xcb_connection_t from Qt6
- */
-static xcb_connection_t *qt_x11_connection()
-{
-    auto x11 = qApp->nativeInterface<QNativeInterface::QX11Application>();
-    if (!x11)
-        return nullptr;
-    return x11->connection();
-}
-
-/*
- * Read a string property from a window (like object path / service name)
- */
-static QByteArray getWindowPropertyString(xcb_window_t id, const QByteArray &name)
-{
-    xcb_connection_t *c = qt_x11_connection();
-    QByteArray value;
-
-    if (!c)
-        return value;
-
-    const xcb_intern_atom_cookie_t atomCookie =
-            xcb_intern_atom(c, false, name.size(), name.constData());
-    std::unique_ptr<xcb_intern_atom_reply_t, void(*)(xcb_intern_atom_reply_t*)> atomReply(
-            xcb_intern_atom_reply(c, atomCookie, nullptr),
-            [](xcb_intern_atom_reply_t *p){ if (p) free(p); });
-
-    if (!atomReply)
-        return value;
-
-    static const uint32_t MAX_PROP_SIZE = 10000;
-    xcb_get_property_cookie_t propertyCookie =
-            xcb_get_property(c, false, id, atomReply->atom, XCB_ATOM_STRING, 0, MAX_PROP_SIZE);
-
-    std::unique_ptr<xcb_get_property_reply_t, void(*)(xcb_get_property_reply_t*)> propertyReply(
-            xcb_get_property_reply(c, propertyCookie, nullptr),
-            [](xcb_get_property_reply_t *p){ if (p) free(p); });
-
-    if (!propertyReply)
-        return value;
-
-    if (propertyReply->type == XCB_ATOM_STRING &&
-        propertyReply->format == 8 &&
-        propertyReply->value_len > 0) {
-
-        const char *data = reinterpret_cast<const char*>(xcb_get_property_value(propertyReply.get()));
-        int len = propertyReply->value_len;
-        if (data)
-            value = QByteArray(data, data[len - 1] ? len : len - 1);
-    }
-
-    return value;
-}
-
-/*
- * Get the current active window using _NET_ACTIVE_WINDOW on the root window.
- * Returns 0 when unavailable.
- */
-static xcb_window_t getActiveWindow()
-{
-    xcb_connection_t *c = qt_x11_connection();
-    if (!c)
-        return 0;
-
-    xcb_screen_iterator_t it = xcb_setup_roots_iterator(xcb_get_setup(c));
-    xcb_screen_t *screen = it.data;
-    if (!screen)
-        return 0;
-
-    xcb_window_t root = screen->root;
-    const QByteArray atomName = QByteArrayLiteral("_NET_ACTIVE_WINDOW");
-
-    xcb_intern_atom_cookie_t atomCookie =
-            xcb_intern_atom(c, false, atomName.size(), atomName.constData());
-    std::unique_ptr<xcb_intern_atom_reply_t, void(*)(xcb_intern_atom_reply_t*)> atomReply(
-            xcb_intern_atom_reply(c, atomCookie, nullptr),
-            [](xcb_intern_atom_reply_t *p){ if (p) free(p); });
-
-    if (!atomReply)
-        return 0;
-
-    xcb_get_property_cookie_t propCookie =
-            xcb_get_property(c, false, root, atomReply->atom, XCB_ATOM_WINDOW, 0, 1);
-
-    std::unique_ptr<xcb_get_property_reply_t, void(*)(xcb_get_property_reply_t*)> propReply(
-            xcb_get_property_reply(c, propCookie, nullptr),
-            [](xcb_get_property_reply_t *p){ if (p) free(p); });
-
-    if (!propReply)
-        return 0;
-
-    if (propReply->value_len == 0)
-        return 0;
-
-    // value is window id (CARD32)
-    uint32_t *val = reinterpret_cast<uint32_t*>(xcb_get_property_value(propReply.get()));
-    if (!val)
-        return 0;
-
-    return static_cast<xcb_window_t>(*val);
-}
-
-/* ------------------------------------------------------------------ */
+#include "../windowinfocache.h"
+#include "../dbusmenuregistry.h"
 
 class CDBusMenuImporter : public DBusMenuImporter
 {
@@ -170,13 +64,14 @@ AppMenuModel::AppMenuModel(QObject *parent)
         }
     });
 
-    // Polling timer to detect active window changes (替代 KWindowSystem 信号)
-    QTimer *pollTimer = new QTimer(this);
-    pollTimer->setInterval(400); // 400ms, 可调
-    connect(pollTimer, &QTimer::timeout, this, &AppMenuModel::onActiveWindowChanged);
-    pollTimer->start();
+    connect(KX11Extras::self(), &KX11Extras::activeWindowChanged, this, &AppMenuModel::onActiveWindowChanged);
+
+    // The appmenu properties are often set after the window got focus.
+    connect(WindowInfoCache::self(), &WindowInfoCache::windowChanged, this, [this](WId id) {
+        if (id == m_currentWindowId)
+            onActiveWindowChanged();
+    });
 
-    // 初始触发一次
     onActiveWindowChanged();
 
     m_serviceWatcher->setConnection(QDBusConnection::sessionBus());
@@ -190,7 +85,10 @@ AppMenuModel::AppMenuModel(QObject *parent)
     });
 }
 
-AppMenuModel::~AppMenuModel() = default;
+AppMenuModel::~AppMenuModel()
+{
+    DBusMenuRegistry::self()->release(m_importer);
+}
 
 bool AppMenuModel::menuAvailable() const
 {
@@ -238,16 +136,18 @@ void AppMenuModel::update()
 
 void AppMenuModel::onActiveWindowChanged()
 {
-    // read active window via EWMH
-    const xcb_window_t active = getActiveWindow();
+    const WId active = KX11Extras::activeWindow();
+    m_currentWindowId = active;
+
     if (!active) {
         // no active window
         setVisible(false);
         return;
     }
 
-    const QString objectPath = QString::fromUtf8(getWindowPropertyString(active, QByteArrayLiteral("_KDE_NET_WM_APPMENU_OBJECT_PATH")));
-    const QString serviceName = QString::fromUtf8(getWindowPropertyString(active, QByteArrayLiteral("_KDE_NET_WM_APPMENU_SERVICE_NAME")));
+    const WindowInfo info = WindowInfoCache::self()->info(active);
+    const QString &objectPath = info.appMenuObjectPath;
+    const QString &serviceName = info.appMenuServiceName;
 
     if (!objectPath.isEmpty() && !serviceName.isEmpty()) {
         setMenuAvailable(true);
@@ -303,42 +203,24 @@ void AppMenuModel::updateApplicationMenu(const QString &serviceName, const QStri
 
     m_menuObjectPath = menuObjectPath;
 
+    // The previous importer stays warm in the registry for a while.
     if (m_importer) {
-        m_importer->deleteLater();
+        disconnect(m_importer, nullptr, this, nullptr);
+        if (m_menu) {
+            for (QAction *a : m_menu->actions())
+                disconnect(a, nullptr, this, nullptr);
+        }
+        DBusMenuRegistry::self()->release(m_importer);
+        m_menu.clear();
+        emit modelNeedsUpdate();
     }
 
-    m_importer = new CDBusMenuImporter(serviceName, menuObjectPath, this);
-    QMetaObject::invokeMethod(m_importer, "updateMenu", Qt::QueuedConnection);
+    m_importer = DBusMenuRegistry::self()->acquire<CDBusMenuImporter>(serviceName, menuObjectPath);
 
     connect(m_importer.data(), &DBusMenuImporter::menuUpdated, this, [=](QMenu *menu) {
-        m_menu = m_importer->menu();
-        if (m_menu.isNull() || menu != m_menu) {
-            return;
+        if (menu == m_importer->menu()) {
+            applyMenu(true);
         }
-
-        // cache first layer of sub menus, which we'll be popping up
-        const auto actions = m_menu->actions();
-        for (QAction *a : actions) {
-            // signal dataChanged when the action changes
-            connect(a, &QAction::changed, this, [this, a] {
-                if (m_menuAvailable && m_menu) {
-                    const int actionIdx = m_menu->actions().indexOf(a);
-                    if (actionIdx > -1) {
-                        const QModelIndex modelIdx = index(actionIdx, 0);
-                        emit dataChanged(modelIdx, modelIdx);
-                    }
-                }
-            });
-
-            connect(a, &QAction::destroyed, this, &AppMenuModel::modelNeedsUpdate);
-
-            if (a->menu()) {
-                m_importer->updateMenu(a->menu());
-            }
-        }
-
-        setMenuAvailable(true);
-        emit modelNeedsUpdate();
     });
 
     connect(m_importer.data(), &DBusMenuImporter::actionActivationRequested, this, [this](QAction *action) {
@@ -353,4 +235,47 @@ void AppMenuModel::updateApplicationMenu(const QString &serviceName, const QStri
             Q_EMIT requestActivateIndex(it - actions.begin());
         }
     });
+
+    if (DBusMenuRegistry::isWarm(m_importer)) {
+        applyMenu(false);
+    } else {
+        QMetaObject::invokeMethod(m_importer, "updateMenu", Qt::QueuedConnection);
+    }
+}
+
+void AppMenuModel::populateMenu(QMenu *menu)
+{
+    if (m_importer) {
+        m_importer->populateMenu(menu);
+    }
+}
+
+void AppMenuModel::applyMenu(bool fetchSubmenus)
+{
+    m_menu = m_importer->menu();
+
+    // cache first layer of sub menus, which we'll be popping up
+    const auto actions = m_menu->actions();
+    for (QAction *a : actions) {
+        // signal dataChanged when the action changes
+        connect(a, &QAction::changed, this, [this, a] {
+            if (m_menuAvailable && m_menu) {
+                const int actionIdx = m_menu->actions().indexOf(a);
+                if (actionIdx > -1) {
+                    const QModelIndex modelIdx = index(actionIdx, 0);
+                    emit dataChanged(modelIdx, modelIdx);
+                }
+            }
+        });
+
+        connect(a, &QAction::destroyed, this, &AppMenuModel::modelNeedsUpdate);
+
+        // A warm importer keeps its submenus current from LayoutUpdated.
+        if (fetchSubmenus && a->menu()) {
+            m_importer->updateMenu(a->menu());
+        }
+    }
+
+    setMenuAvailable(true);
+    emit modelNeedsUpdate();
 }
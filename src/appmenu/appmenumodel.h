@@ -28,6 +28,7 @@
 #include <QPointer>
 #include <QRect>
 #include <QStringList>
+#include <QQmlEngine>
 
 class QMenu;
 class QModelIndex;
@@ -37,6 +38,7 @@ class CDBusMenuImporter;
 class AppMenuModel : public QAbstractListModel
 {
     Q_OBJECT
+    QML_ELEMENT
 
     Q_PROPERTY(bool menuAvailable READ menuAvailable WRITE setMenuAvailable NOTIFY menuAvailableChanged)
     Q_PROPERTY(bool visible READ visible NOTIFY visibleChanged)
@@ -55,6 +57,7 @@ public:
     QHash<int, QByteArray> roleNames() const override;
 
     void updateApplicationMenu(const QString &serviceName, const QString &menuObjectPath);
+    void populateMenu(QMenu *menu);
 
     bool menuAvailable() const;
     void setMenuAvailable(bool set);
@@ -74,6 +77,9 @@ Q_SIGNALS:
     void modelNeedsUpdate();
     void visibleChanged();
 
+private:
+    void applyMenu(bool fetchSubmenus);
+
 private:
     bool m_menuAvailable;
     bool m_updatePending = false;
@@ -25,11 +25,11 @@
 #include "menuimporter.h"
 #include "../libdbusmenuqt/dbusmenutypes_p.h"
 #include "menuimporteradaptor.h"
+#include "../windowinfocache.h"
 
 #include <QDBusMessage>
 #include <QDBusServiceWatcher>
 
-#include <KWindowInfo>
 #include <KWindowSystem>
 
 static const char *DBUS_SERVICE = "com.canonical.AppMenu.Registrar";
@@ -63,9 +63,8 @@ bool MenuImporter::connectToBus()
 
 void MenuImporter::RegisterWindow(WId id, const QDBusObjectPath &path)
 {
-    KWindowInfo info(id, NET::WMWindowType, NET::WM2WindowClass);
-    NET::WindowTypes mask = NET::AllTypesMask;
-    auto type = info.windowType(mask);
+    WindowInfo info = WindowInfoCache::self()->info(id);
+    auto type = info.windowType;
 
     // Menu can try to register, right click in gimp for example
     if (type != NET::Unknown && (type & (NET::Menu | NET::DropdownMenu | NET::PopupMenu))) {
@@ -77,7 +76,7 @@ void MenuImporter::RegisterWindow(WId id, const QDBusObjectPath &path)
 
     QString service = message().service();
 
-    QString classClass = info.windowClassClass();
+    QString classClass = info.windowClassClass;
     m_windowClasses.insert(id, classClass);
     m_menuServices.insert(id, service);
     m_menuPaths.insert(id, path);
@@ -18,19 +18,189 @@
  */
 
 #include "backgroundhelper.h"
+#include "ecomode.h"
+#include "tracer.h"
 
 #include <QApplication>
+#include <QCryptographicHash>
+#include <QDateTime>
 #include <QDebug>
-#include <QPixmap>
-#include <QPixmapCache>
+#include <QDir>
+#include <QFileInfo>
+#include <QFutureWatcher>
+#include <QImageReader>
 #include <QScreen>
+#include <QSettings>
+#include <QStandardPaths>
 #include <QRgb>
+#include <QtConcurrent>
+
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+static const QColor s_defaultColor("#2D2D2D");
+
+// Wallpapers remembered in the on-disk color cache.
+static const int s_maxCachedColors = 32;
+
+static QSettings *colorCache()
+{
+    static QSettings *settings = nullptr;
+
+    if (!settings) {
+        const QString path = QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation)
+                             + QStringLiteral("/cutefish-statusbar");
+        QDir().mkpath(path);
+        settings = new QSettings(path + QStringLiteral("/wallpapercolors.ini"), QSettings::IniFormat);
+    }
+
+    return settings;
+}
+
+static QString colorCacheKey(const QString &fileName, const QRect &screenRect, int barHeight)
+{
+    const QFileInfo info(fileName);
+
+    if (!info.exists())
+        return QString();
+
+    const QString id = QStringList({ info.absoluteFilePath(),
+                                     QString::number(info.lastModified().toMSecsSinceEpoch()),
+                                     QString::number(info.size()),
+                                     QString::number(screenRect.x()),
+                                     QString::number(screenRect.y()),
+                                     QString::number(screenRect.width()),
+                                     QString::number(screenRect.height()),
+                                     QString::number(barHeight) }).join(QLatin1Char('|'));
+
+    return QString::fromLatin1(QCryptographicHash::hash(id.toUtf8(), QCryptographicHash::Md5).toHex());
+}
+
+// Stored as "#rrggbb;LCR" with one 0/1 digit per region.
+static bool cachedAnalysis(const QString &key, BackgroundHelper::Analysis &analysis)
+{
+    if (key.isEmpty())
+        return false;
+
+    const QStringList parts = colorCache()->value(QStringLiteral("Colors/") + key).toString().split(QLatin1Char(';'));
+    if (parts.size() != 2 || parts.at(1).size() != BackgroundHelper::RegionCount)
+        return false;
+
+    analysis.color = QColor(parts.at(0));
+    for (int i = 0; i < BackgroundHelper::RegionCount; ++i)
+        analysis.regionDark[i] = parts.at(1).at(i) == QLatin1Char('1');
+
+    return analysis.color.isValid();
+}
+
+static void storeAnalysis(const QString &key, const BackgroundHelper::Analysis &analysis)
+{
+    if (key.isEmpty())
+        return;
+
+    QSettings *settings = colorCache();
+
+    // Least recently stored entries go first.
+    QStringList order = settings->value(QStringLiteral("Order")).toStringList();
+    order.removeAll(key);
+    order.append(key);
+
+    while (order.size() > s_maxCachedColors)
+        settings->remove(QStringLiteral("Colors/") + order.takeFirst());
+
+    QString regions;
+    for (int i = 0; i < BackgroundHelper::RegionCount; ++i)
+        regions += analysis.regionDark[i] ? QLatin1Char('1') : QLatin1Char('0');
+
+    settings->setValue(QStringLiteral("Colors/") + key, analysis.color.name() + QLatin1Char(';') + regions);
+    settings->setValue(QStringLiteral("Order"), order);
+}
+
+// Sums the B, G and R bytes of a row of 32-bit pixels.
+static void sumRow(const QRgb *line, int width, quint64 &sumR, quint64 &sumG, quint64 &sumB)
+{
+    int x = 0;
+
+#if defined(__SSE2__)
+    // _mm_sad_epu8 against zero adds up eight bytes per lane, so masking out
+    // all but one channel gives that channel's sum for four pixels at once.
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i blueMask = _mm_set1_epi32(0x000000ff);
+    const __m128i greenMask = _mm_set1_epi32(0x0000ff00);
+    const __m128i redMask = _mm_set1_epi32(0x00ff0000);
+
+    __m128i accR = zero, accG = zero, accB = zero;
+
+    for (; x + 4 <= width; x += 4) {
+        const __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i *>(line + x));
+        accB = _mm_add_epi64(accB, _mm_sad_epu8(_mm_and_si128(px, blueMask), zero));
+        accG = _mm_add_epi64(accG, _mm_sad_epu8(_mm_and_si128(px, greenMask), zero));
+        accR = _mm_add_epi64(accR, _mm_sad_epu8(_mm_and_si128(px, redMask), zero));
+    }
+
+    quint64 lanes[2];
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes), accR);
+    sumR += lanes[0] + lanes[1];
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes), accG);
+    sumG += lanes[0] + lanes[1];
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes), accB);
+    sumB += lanes[0] + lanes[1];
+#endif
+
+    for (; x < width; ++x) {
+        sumR += qRed(line[x]);
+        sumG += qGreen(line[x]);
+        sumB += qBlue(line[x]);
+    }
+}
+
+static bool isDarkColor(const QColor &c)
+{
+    return (c.red() * 0.299 +
+            c.green() * 0.587 +
+            c.blue() * 0.114) < 186;
+}
+
+static BackgroundHelper::Analysis solidAnalysis(const QColor &c)
+{
+    BackgroundHelper::Analysis analysis;
+    analysis.color = c;
+
+    for (bool &dark : analysis.regionDark)
+        dark = isDarkColor(c);
+
+    return analysis;
+}
 
 BackgroundHelper::BackgroundHelper(QObject *parent)
     : QObject(parent)
     , m_statusBarHeight(25 / qApp->devicePixelRatio())
     , m_type(0)
+    , m_generation(new QAtomicInteger<quint64>(0))
 {
+    m_rescanTimer.setSingleShot(true);
+    connect(&m_rescanTimer, &QTimer::timeout, this, [=] {
+        switch (m_type) {
+        case 0:
+            setBackgound(m_wallpaper);
+            break;
+        case 1:
+            setColor(m_color);
+            break;
+        default:
+            break;
+        }
+    });
+
+    connect(EcoMode::self(), &EcoMode::enabledChanged, this, [=] {
+        // Catch up on a rescan held back while saving power.
+        if (m_rescanTimer.isActive())
+            m_rescanTimer.start(EcoMode::self()->rescanDelay());
+    });
+
     onPrimaryScreenChanged();
     connect(qApp, &QApplication::primaryScreenChanged, this, &BackgroundHelper::onPrimaryScreenChanged);
 }
@@ -40,11 +210,10 @@ void BackgroundHelper::setColor(QColor c)
     m_color = c;
     m_type = 1;
 
-    bool isDark = (c.red() * 0.299 +
-                   c.green() * 0.587 +
-                   c.blue() * 0.114) < 186;
+    // A pending wallpaper job must not override the solid color.
+    m_generation->fetchAndAddRelaxed(1);
 
-    emit newColor(c, isDark);
+    updateColor(solidAnalysis(c));
 }
 
 void BackgroundHelper::setBackgound(const QString &fileName)
@@ -56,56 +225,199 @@ void BackgroundHelper::setBackgound(const QString &fileName)
     if (fileName.isEmpty()) {
         qWarning() << "Failed to load wallpaper: empty filename";
         // Use default color if filename is empty
-        setColor(QColor("#2D2D2D"));
+        setColor(s_defaultColor);
         return;
     }
 
-    QImage img(fileName);
+    const quint64 generation = m_generation->fetchAndAddRelaxed(1) + 1;
+    const QRect screenRect = qApp->primaryScreen()->geometry();
+    const QSize screenSize = screenRect.size();
+    const int barHeight = m_statusBarHeight;
 
-    // Check if image loaded successfully
-    if (img.isNull()) {
-        qWarning() << "Failed to load wallpaper:" << fileName;
-        // Use default color if image fails to load
-        setColor(QColor("#2D2D2D"));
+    // Known wallpaper on a known screen layout, nothing to decode.
+    const QString key = colorCacheKey(fileName, screenRect, barHeight);
+    Analysis known;
+    if (cachedAnalysis(key, known)) {
+        updateColor(known);
         return;
     }
 
-    QSize screenSize = qApp->primaryScreen()->geometry().size();
-    img = img.scaled(screenSize.width(), screenSize.height());
-    img = img.copy(QRect(0, 0, screenSize.width(), m_statusBarHeight));
+    QFutureWatcher<Analysis> *watcher = new QFutureWatcher<Analysis>(this);
+    connect(watcher, &QFutureWatcher<Analysis>::finished, this, [=] {
+        const Analysis analysis = watcher->result();
+        watcher->deleteLater();
+
+        // A newer wallpaper or color was set in the meantime.
+        if (generation != m_generation->loadRelaxed())
+            return;
+
+        if (!analysis.color.isValid()) {
+            qWarning() << "Failed to load wallpaper:" << fileName;
+            // Use default color if image fails to load
+            setColor(s_defaultColor);
+            return;
+        }
+
+        storeAnalysis(key, analysis);
+        updateColor(analysis);
+    });
+
+    watcher->setFuture(QtConcurrent::run(&BackgroundHelper::analyze, fileName, screenSize, barHeight,
+                                         m_generation, generation));
+}
+
+QVariantList BackgroundHelper::regionDarkModes() const
+{
+    QVariantList list;
+
+    for (bool dark : m_last.regionDark)
+        list.append(dark);
+
+    return list;
+}
+
+QVariantList BackgroundHelper::regionTextColors() const
+{
+    QVariantList list;
+
+    for (bool dark : m_last.regionDark)
+        list.append(QColor(dark ? "#FFFFFF" : "#000000"));
+
+    return list;
+}
+
+BackgroundHelper::Analysis BackgroundHelper::analyze(const QString &fileName, const QSize &screenSize, int barHeight,
+                                                     const Generation &generation, quint64 expected)
+{
+    auto superseded = [&] {
+        return generation && generation->loadRelaxed() != expected;
+    };
+
+    // Still queued in the pool while a newer wallpaper was set.
+    if (superseded())
+        return Analysis();
 
-    QSize size(img.size());
-    img = img.scaledToWidth(size.width() * 0.8);
-    size = img.size();
+    TraceSpan span("wallpaper", "analyze", [&] { return QVariantMap {{"file", fileName}}; });
+    QImageReader reader(fileName);
+    const QSize imageSize = reader.size();
 
-    long long sumR = 0, sumG = 0, sumB = 0;
-    int measureArea = size.width() * size.height();
+    if (!imageSize.isValid() || screenSize.isEmpty() || barHeight <= 0 || superseded())
+        return Analysis();
 
-    for (int y = 0; y < size.height(); ++y) {
-        QRgb *line = (QRgb *)img.scanLine(y);
+    // The wallpaper is stretched to the screen and the bar covers its top
+    // rows. Ask the codec for just that strip, decoded at 80% of the screen
+    // width; JPEG does this in the DCT, other formats scale after decoding.
+    const QSize scaledSize(qMax(1, qRound(screenSize.width() * 0.8)),
+                           qMax(1, qRound(screenSize.height() * 0.8)));
+    const QRect clipRect(0, 0, scaledSize.width(), qMax(1, qRound(barHeight * 0.8)));
+
+    reader.setScaledSize(scaledSize);
+    reader.setScaledClipRect(clipRect);
+
+    const QImage image = reader.read();
+    if (superseded())
+        return Analysis();
+
+    return analyzeImage(image);
+}
+
+QColor BackgroundHelper::averageColor(const QImage &image)
+{
+    if (image.isNull())
+        return QColor();
 
-        for (int x = 0; x < size.width(); ++x) {
-            sumR += qRed(line[x]);
-            sumG += qGreen(line[x]);
-            sumB += qBlue(line[x]);
+    QImage img = image;
+    if (img.format() != QImage::Format_RGB32 && img.format() != QImage::Format_ARGB32)
+        img = img.convertToFormat(QImage::Format_RGB32);
+
+    quint64 sumR = 0, sumG = 0, sumB = 0;
+    for (int y = 0; y < img.height(); ++y)
+        sumRow(reinterpret_cast<const QRgb *>(img.constScanLine(y)), img.width(), sumR, sumG, sumB);
+
+    const quint64 measureArea = quint64(img.width()) * img.height();
+    return QColor(sumR / measureArea, sumG / measureArea, sumB / measureArea);
+}
+
+BackgroundHelper::Analysis BackgroundHelper::analyzeImage(const QImage &image)
+{
+    // Luminance histograms are built from every 4th pixel, which is plenty
+    // for a contrast decision and keeps the pass as cheap as the plain sum.
+    static const int sampleStep = 4;
+    static const int bins = 32;
+    static const int darkThreshold = 186;
+
+    Analysis analysis;
+
+    if (image.isNull())
+        return analysis;
+
+    QImage img = image;
+    if (img.format() != QImage::Format_RGB32 && img.format() != QImage::Format_ARGB32)
+        img = img.convertToFormat(QImage::Format_RGB32);
+
+    const int width = img.width();
+    const int height = img.height();
+
+    if (width < RegionCount)
+        return analysis;
+
+    int bounds[RegionCount + 1];
+    for (int i = 0; i <= RegionCount; ++i)
+        bounds[i] = width * i / RegionCount;
+
+    quint64 sumR = 0, sumG = 0, sumB = 0;
+    quint32 histogram[RegionCount][bins] = {};
+
+    for (int y = 0; y < height; ++y) {
+        const QRgb *line = reinterpret_cast<const QRgb *>(img.constScanLine(y));
+
+        for (int r = 0; r < RegionCount; ++r) {
+            sumRow(line + bounds[r], bounds[r + 1] - bounds[r], sumR, sumG, sumB);
+
+            for (int x = bounds[r]; x < bounds[r + 1]; x += sampleStep) {
+                const int luma = (77 * qRed(line[x]) + 150 * qGreen(line[x]) + 29 * qBlue(line[x])) >> 8;
+                ++histogram[r][luma * bins / 256];
+            }
+        }
+    }
+
+    const quint64 measureArea = quint64(width) * height;
+    analysis.color = QColor(sumR / measureArea, sumG / measureArea, sumB / measureArea);
+
+    // A region wants light text when most of it is darker than the threshold.
+    const int binWidth = 256 / bins;
+    for (int r = 0; r < RegionCount; ++r) {
+        quint64 total = 0;
+        quint64 dark = 0;
+
+        for (int b = 0; b < bins; ++b) {
+            total += histogram[r][b];
+
+            if ((b + 1) * binWidth <= darkThreshold)
+                dark += histogram[r][b];
+            else if (b * binWidth < darkThreshold)
+                dark += histogram[r][b] * (darkThreshold - b * binWidth) / binWidth;
         }
+
+        analysis.regionDark[r] = dark * 2 >= total;
     }
 
-    sumR /= measureArea;
-    sumG /= measureArea;
-    sumB /= measureArea;
+    return analysis;
+}
 
-    QColor c = QColor(sumR, sumG, sumB);
-    QColor textColor = (sumR * 0.299 +
-                        sumG * 0.587 +
-                        sumB * 0.114) > 186 ? "#000000" : "#FFFFFF";
+void BackgroundHelper::updateColor(const Analysis &analysis)
+{
+    const bool colorChanged = analysis.color != m_last.color;
+    const bool regionChanged = !std::equal(std::begin(analysis.regionDark), std::end(analysis.regionDark),
+                                           std::begin(m_last.regionDark));
 
-    qDebug() << c << textColor;
+    m_last = analysis;
 
-    emit newColor(c, textColor == "#FFFFFF");
+    if (colorChanged)
+        emit newColor(analysis.color, isDarkColor(analysis.color));
 
-    // clear cache.
-    QPixmapCache::clear();
+    if (regionChanged)
+        emit regionsChanged();
 }
 
 void BackgroundHelper::onPrimaryScreenChanged()
@@ -118,14 +430,6 @@ void BackgroundHelper::onPrimaryScreenChanged()
 
 void BackgroundHelper::onChanged()
 {
-    switch (m_type) {
-    case 0:
-        setBackgound(m_wallpaper);
-        break;
-    case 1:
-        setColor(m_color);
-        break;
-    default:
-        break;
-    }
+    // Geometry changes come in bursts, in eco mode hold the rescan back longer.
+    m_rescanTimer.start(EcoMode::self()->rescanDelay());
 }
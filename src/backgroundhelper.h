@@ -21,30 +21,79 @@
 #define BACKGROUNDHELPER_H
 
 #include <QObject>
+#include <QAtomicInteger>
+#include <QSharedPointer>
 #include <QColor>
+#include <QImage>
+#include <QSize>
+#include <QTimer>
+#include <QVariantList>
+#include <QQmlEngine>
 
 class BackgroundHelper : public QObject
 {
     Q_OBJECT
+    QML_ELEMENT
+    Q_PROPERTY(QVariantList regionDarkModes READ regionDarkModes NOTIFY regionsChanged)
+    Q_PROPERTY(QVariantList regionTextColors READ regionTextColors NOTIFY regionsChanged)
 
 public:
+    // Equal horizontal thirds of the bar.
+    enum Region {
+        Left = 0,
+        Center,
+        Right,
+        RegionCount
+    };
+    Q_ENUM(Region)
+
+    struct Analysis {
+        QColor color;
+        bool regionDark[RegionCount] = { false, false, false };
+    };
+
     explicit BackgroundHelper(QObject *parent = nullptr);
 
     Q_INVOKABLE void setColor(QColor c);
     Q_INVOKABLE void setBackgound(const QString &fileName);
 
+    QVariantList regionDarkModes() const;
+    QVariantList regionTextColors() const;
+
+    using Generation = QSharedPointer<QAtomicInteger<quint64>>;
+
+    // Average color and per-region contrast of the strip the bar covers,
+    // computed off the GUI thread. Gives up early once generation no longer
+    // holds expected.
+    static Analysis analyze(const QString &fileName, const QSize &screenSize, int barHeight,
+                            const Generation &generation = Generation(), quint64 expected = 0);
+    static Analysis analyzeImage(const QImage &img);
+    // Whole-strip average only, what analyzeImage is benchmarked against.
+    static QColor averageColor(const QImage &img);
+
 private slots:
     void onPrimaryScreenChanged();
     void onChanged();
 
 signals:
     void newColor(QColor color, bool darkMode);
+    void regionsChanged();
+
+private:
+    void updateColor(const Analysis &analysis);
 
 private:
     int m_statusBarHeight;
     int m_type;
     QColor m_color;
     QString m_wallpaper;
+
+    Analysis m_last;
+
+    // Bumped for every request, older jobs stop and their results are dropped.
+    Generation m_generation;
+
+    QTimer m_rescanTimer;
 };
 
 #endif // BACKGROUNDHELPER_H
@@ -19,7 +19,6 @@
 
 #include "battery.h"
 #include <QSettings>
-#include <QDBusPendingCall>
 
 static const QString s_sServer = "com.cutefish.Settings";
 static const QString s_sPath = "/PrimaryBattery";
@@ -35,50 +34,41 @@ Battery *Battery::self()
     return SELF;
 }
 
+Battery *Battery::create(QQmlEngine *, QJSEngine *)
+{
+    // Shared with the C++ side, the engine must not take ownership.
+    QJSEngine::setObjectOwnership(self(), QJSEngine::CppOwnership);
+    return self();
+}
+
 Battery::Battery(QObject *parent)
     : QObject(parent)
-    , m_upowerInterface("org.freedesktop.UPower",
-                        "/org/freedesktop/UPower",
-                        "org.freedesktop.UPower",
-                        QDBusConnection::systemBus())
-    , m_interface("com.cutefish.Settings",
-                  "/PrimaryBattery",
-                  "com.cutefish.PrimaryBattery",
-                  QDBusConnection::sessionBus())
+    , m_upower("org.freedesktop.UPower",
+               "/org/freedesktop/UPower",
+               "org.freedesktop.UPower",
+               QDBusConnection::systemBus())
+    , m_properties(s_sServer, s_sPath, s_sInterface, QDBusConnection::sessionBus())
     , m_available(false)
     , m_onBattery(false)
     , m_showPercentage(false)
 {
-    m_available = m_interface.isValid() && !m_interface.lastError().isValid();
-
-    if (m_available) {
-        QSettings settings("cutefishos", "statusbar");
-        settings.setDefaultFormat(QSettings::IniFormat);
-        m_showPercentage = settings.value("BatteryPercentage", false).toBool();
-
-        QDBusConnection::sessionBus().connect(s_sServer, s_sPath, s_sInterface, "chargeStateChanged", this, SLOT(chargeStateChanged(int)));
-        QDBusConnection::sessionBus().connect(s_sServer, s_sPath, s_sInterface, "chargePercentChanged", this, SLOT(chargePercentChanged(int)));
-        QDBusConnection::sessionBus().connect(s_sServer, s_sPath, s_sInterface, "lastChargedPercentChanged", this, SLOT(lastChargedPercentChanged()));
-        QDBusConnection::sessionBus().connect(s_sServer, s_sPath, s_sInterface, "capacityChanged", this, SLOT(capacityChanged(int)));
-        QDBusConnection::sessionBus().connect(s_sServer, s_sPath, s_sInterface, "remainingTimeChanged", this, SLOT(remainingTimeChanged(qlonglong)));
-
-        // Update Icon
-        QDBusConnection::sessionBus().connect(s_sServer, s_sPath, s_sInterface, "chargePercentChanged", this, SLOT(iconSourceChanged()));
-
-        QDBusInterface interface("org.freedesktop.UPower", "/org/freedesktop/UPower",
-                                 "org.freedesktop.UPower", QDBusConnection::systemBus());
-
-        QDBusConnection::systemBus().connect("org.freedesktop.UPower", "/org/freedesktop/UPower",
-                                             "org.freedesktop.DBus.Properties",
-                                             "PropertiesChanged", this,
-                                             SLOT(onPropertiesChanged(QString, QVariantMap, QStringList)));
+    QSettings settings("cutefishos", "statusbar");
+    settings.setDefaultFormat(QSettings::IniFormat);
+    m_showPercentage = settings.value("BatteryPercentage", false).toBool();
 
-        if (interface.isValid()) {
-            m_onBattery = interface.property("OnBattery").toBool();
-        }
+    m_properties.watchSignal("chargeStateChanged", "chargeState");
+    m_properties.watchSignal("chargePercentChanged", "chargePercent");
+    m_properties.watchSignal("lastChargedPercentChanged", "lastChargedPercent");
+    m_properties.watchSignal("capacityChanged", "capacity");
+    m_properties.watchSignal("remainingTimeChanged", "remainingTime");
 
+    connect(&m_properties, &DBusPropertyCache::propertyChanged, this, &Battery::onPropertyChanged);
+    connect(&m_properties, &DBusPropertyCache::ready, this, [=] {
+        m_available = true;
         emit validChanged();
-    }
+    });
+
+    connect(&m_upower, &DBusPropertyCache::propertyChanged, this, &Battery::onUPowerPropertyChanged);
 }
 
 bool Battery::available() const
@@ -112,27 +102,27 @@ void Battery::setShowPercentage(bool enabled)
 
 int Battery::chargeState() const
 {
-    return m_interface.property("chargeState").toInt();
+    return m_properties.value("chargeState").toInt();
 }
 
 int Battery::chargePercent() const
 {
-    return m_interface.property("chargePercent").toInt();
+    return m_properties.value("chargePercent").toInt();
 }
 
 int Battery::lastChargedPercent() const
 {
-    return m_interface.property("lastChargedPercent").toInt();
+    return m_properties.value("lastChargedPercent").toInt();
 }
 
 int Battery::capacity() const
 {
-    return m_interface.property("capacity").toInt();
+    return m_properties.value("capacity").toInt();
 }
 
 QString Battery::statusString() const
 {
-    return m_interface.property("statusString").toString();
+    return m_properties.value("statusString").toString();
 }
 
 QString Battery::iconSource() const
@@ -169,16 +159,35 @@ QString Battery::iconSource() const
     return QString("battery-level-%1-charging-symbolic.svg").arg(range);
 }
 
-void Battery::onPropertiesChanged(const QString &ifaceName, const QVariantMap &changedProps, const QStringList &invalidatedProps)
+void Battery::onPropertyChanged(const QString &name, const QVariant &value)
 {
-    Q_UNUSED(ifaceName);
-    Q_UNUSED(changedProps);
-    Q_UNUSED(invalidatedProps);
+    if (name == "chargeState") {
+        emit chargeStateChanged(value.toInt());
+    } else if (name == "chargePercent") {
+        emit chargePercentChanged(value.toInt());
+        emit iconSourceChanged();
+    } else if (name == "lastChargedPercent") {
+        emit lastChargedPercentChanged();
+    } else if (name == "capacity") {
+        emit capacityChanged(value.toInt());
+    } else if (name == "remainingTime") {
+        // statusString is derived from the remaining time.
+        m_properties.refreshProperty("statusString");
+        emit remainingTimeChanged(value.toLongLong());
+    } else if (name == "statusString") {
+        emit statusStringChanged();
+    }
+}
+
+void Battery::onUPowerPropertyChanged(const QString &name, const QVariant &value)
+{
+    if (name != "OnBattery")
+        return;
 
-    bool onBattery = m_upowerInterface.property("OnBattery").toBool();
+    bool onBattery = value.toBool();
     if (onBattery != m_onBattery) {
         m_onBattery = onBattery;
-        m_interface.call("refresh");
+        m_properties.asyncCall("refresh");
         emit onBatteryChanged();
         emit iconSourceChanged();
     }
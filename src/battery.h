@@ -21,23 +21,27 @@
 #define BATTERY_H
 
 #include <QObject>
-#include <QDBusInterface>
+#include <QQmlEngine>
+#include "dbuspropertycache.h"
 
 class Battery : public QObject
 {
     Q_OBJECT
+    QML_ELEMENT
+    QML_SINGLETON
     Q_PROPERTY(bool available READ available NOTIFY validChanged)
     Q_PROPERTY(int chargeState READ chargeState NOTIFY chargeStateChanged)
     Q_PROPERTY(int chargePercent READ chargePercent NOTIFY chargePercentChanged)
     Q_PROPERTY(int lastChargedPercent READ lastChargedPercent NOTIFY lastChargedPercentChanged)
     Q_PROPERTY(int capacity READ capacity NOTIFY capacityChanged)
-    Q_PROPERTY(QString statusString READ statusString NOTIFY remainingTimeChanged)
+    Q_PROPERTY(QString statusString READ statusString NOTIFY statusStringChanged)
     Q_PROPERTY(bool onBattery READ onBattery NOTIFY onBatteryChanged)
     Q_PROPERTY(bool showPercentage READ showPercentage NOTIFY showPercentageChanged)
     Q_PROPERTY(QString iconSource READ iconSource NOTIFY iconSourceChanged)
 
 public:
     static Battery *self();
+    static Battery *create(QQmlEngine *, QJSEngine *);
     explicit Battery(QObject *parent = nullptr);
 
     bool available() const;
@@ -60,17 +64,19 @@ signals:
     void chargePercentChanged(int);
     void capacityChanged(int);
     void remainingTimeChanged(qlonglong time);
+    void statusStringChanged();
     void onBatteryChanged();
     void lastChargedPercentChanged();
     void iconSourceChanged();
     void showPercentageChanged();
 
 private slots:
-    void onPropertiesChanged(const QString &ifaceName, const QVariantMap &changedProps, const QStringList &invalidatedProps);
+    void onPropertyChanged(const QString &name, const QVariant &value);
+    void onUPowerPropertyChanged(const QString &name, const QVariant &value);
 
 private:
-    QDBusInterface m_upowerInterface;
-    QDBusInterface m_interface;
+    DBusPropertyCache m_upower;
+    DBusPropertyCache m_properties;
     bool m_available;
     bool m_onBattery;
     bool m_showPercentage;
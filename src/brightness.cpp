@@ -18,27 +18,40 @@
  */
 
 #include "brightness.h"
-#include <QDBusPendingCall>
+
+static Brightness *SELF = nullptr;
+
+Brightness *Brightness::self()
+{
+    if (!SELF)
+        SELF = new Brightness;
+
+    return SELF;
+}
+
+Brightness *Brightness::create(QQmlEngine *, QJSEngine *)
+{
+    // Shared with the C++ side, the engine must not take ownership.
+    QJSEngine::setObjectOwnership(self(), QJSEngine::CppOwnership);
+    return self();
+}
 
 Brightness::Brightness(QObject *parent)
     : QObject(parent)
-    , m_dbusConnection(QDBusConnection::sessionBus())
-    , m_iface("com.cutefish.Settings",
-              "/Brightness",
-              "com.cutefish.Brightness", m_dbusConnection)
+    , m_properties("com.cutefish.Settings",
+                   "/Brightness",
+                   "com.cutefish.Brightness", QDBusConnection::sessionBus())
+    , m_valueWriter(&m_properties, "setValue", "brightness")
     , m_value(0)
     , m_enabled(false)
 {
-    if (!m_iface.isValid())
-        return;
-
-    m_value = m_iface.property("brightness").toInt();
-    m_enabled = m_iface.property("brightnessEnabled").toBool();
+    m_properties.watchSignal("brightnessChanged", "brightness");
+    connect(&m_properties, &DBusPropertyCache::propertyChanged, this, &Brightness::onPropertyChanged);
 }
 
 void Brightness::setValue(int value)
 {
-    m_iface.asyncCall("setValue", value);
+    m_valueWriter.write(value);
 }
 
 int Brightness::value() const
@@ -50,3 +63,18 @@ bool Brightness::enabled() const
 {
     return m_enabled;
 }
+
+void Brightness::onPropertyChanged(const QString &name, const QVariant &value)
+{
+    if (name == "brightness") {
+        if (m_value != value.toInt()) {
+            m_value = value.toInt();
+            emit valueChanged();
+        }
+    } else if (name == "brightnessEnabled") {
+        if (m_enabled != value.toBool()) {
+            m_enabled = value.toBool();
+            emit enabledChanged();
+        }
+    }
+}
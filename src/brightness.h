@@ -21,15 +21,22 @@
 #define BRIGHTNESS_H
 
 #include <QObject>
-#include <QDBusInterface>
+#include <QQmlEngine>
+#include "dbuspropertycache.h"
+#include "dbuswritecoalescer.h"
 
 class Brightness : public QObject
 {
     Q_OBJECT
+    QML_ELEMENT
+    QML_SINGLETON
     Q_PROPERTY(int value READ value NOTIFY valueChanged)
-    Q_PROPERTY(bool enabled READ enabled CONSTANT)
+    Q_PROPERTY(bool enabled READ enabled NOTIFY enabledChanged)
 
 public:
+    static Brightness *self();
+    static Brightness *create(QQmlEngine *, QJSEngine *);
+
     explicit Brightness(QObject *parent = nullptr);
 
     Q_INVOKABLE void setValue(int value);
@@ -39,10 +46,14 @@ public:
 
 signals:
     void valueChanged();
+    void enabledChanged();
+
+private slots:
+    void onPropertyChanged(const QString &name, const QVariant &value);
 
 private:
-    QDBusConnection m_dbusConnection;
-    QDBusInterface m_iface;
+    DBusPropertyCache m_properties;
+    DBusWriteCoalescer m_valueWriter;
     int m_value;
     bool m_enabled;
 };
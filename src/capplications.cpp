@@ -18,6 +18,9 @@
  */
 
 #include "capplications.h"
+#include "ecomode.h"
+#include "stallwatchdog.h"
+#include "tracer.h"
 
 #include <QRegularExpression>
 #include <QSettings>
@@ -26,8 +29,24 @@
 #include <QDirIterator>
 #include <QDir>
 
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <utility>
+
 static CApplications *SELF = nullptr;
-static QString s_systemAppFolder = "/usr/share/applications";
+static const int s_processCacheSize = 64;
+
+static QStringList applicationFolders()
+{
+    return { "/usr/share/applications",
+             "/var/lib/flatpak/exports/share/applications",
+             QDir::homePath() + "/.local/share/flatpak/exports/share/applications",
+             "/var/lib/snapd/desktop/applications" };
+}
 
 static QByteArray detectDesktopEnvironment()
 {
@@ -39,6 +58,155 @@ static QByteArray detectDesktopEnvironment()
     return QByteArray("UNKNOWN");
 }
 
+// Reads /proc/<pid>/<entry> into buf without touching the heap.
+static qint64 readProcFile(quint32 pid, const char *entry, char *buf, qint64 size)
+{
+    char path[64];
+    qsnprintf(path, sizeof(path), "/proc/%u/%s", pid, entry);
+
+    int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+
+    qint64 total = 0;
+    while (total < size) {
+        ssize_t n = ::read(fd, buf + total, size - total);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        total += n;
+    }
+
+    ::close(fd);
+    return total;
+}
+
+// Field 22 of /proc/<pid>/stat, in clock ticks since boot.
+// Together with the pid it uniquely identifies a process.
+static quint64 processStartTime(quint32 pid)
+{
+    char buf[1024];
+    const qint64 len = readProcFile(pid, "stat", buf, sizeof(buf) - 1);
+    if (len <= 0)
+        return 0;
+    buf[len] = '\0';
+
+    // comm (field 2) may contain spaces and parentheses, so start after the last ')'.
+    const char *p = strrchr(buf, ')');
+    if (!p)
+        return 0;
+
+    int field = 2;
+    for (++p; *p && field < 22; ++p) {
+        if (*p == ' ')
+            ++field;
+    }
+
+    return field == 22 ? strtoull(p, nullptr, 10) : 0;
+}
+
+static const char *findBytes(const char *begin, const char *end, const char *needle)
+{
+    const size_t needleLen = strlen(needle);
+
+    for (const char *p = begin; p + needleLen <= end; ++p) {
+        if (memcmp(p, needle, needleLen) == 0)
+            return p;
+    }
+
+    return nullptr;
+}
+
+static QString flatpakAppId(quint32 pid)
+{
+    char buf[2048];
+    qint64 len = readProcFile(pid, "root/.flatpak-info", buf, sizeof(buf));
+
+    if (len > 0) {
+        const char *end = buf + len;
+        const char *section = findBytes(buf, end, "[Application]");
+        const char *key = section ? findBytes(section, end, "\nname=") : nullptr;
+
+        if (key) {
+            const char *begin = key + 6;
+            const char *stop = static_cast<const char *>(memchr(begin, '\n', end - begin));
+            return QString::fromLatin1(begin, (stop ? stop : end) - begin);
+        }
+    }
+
+    // No access to the sandbox root, fall back to the systemd scope name:
+    // .../app-flatpak-org.gnome.Calculator-12345.scope
+    len = readProcFile(pid, "cgroup", buf, sizeof(buf));
+    if (len <= 0)
+        return QString();
+
+    const char *end = buf + len;
+    const char *scope = findBytes(buf, end, "app-flatpak-");
+    if (!scope)
+        return QString();
+
+    const char *begin = scope + 12;
+    const char *stop = begin;
+    while (stop < end && *stop != '\n')
+        ++stop;
+
+    // Strip the trailing "-<pid>.scope".
+    const char *dash = stop;
+    while (dash > begin && *dash != '-')
+        --dash;
+
+    return dash > begin ? QString::fromLatin1(begin, dash - begin) : QString();
+}
+
+static QString snapDesktopName(quint32 pid)
+{
+    char buf[2048];
+    const qint64 len = readProcFile(pid, "cgroup", buf, sizeof(buf));
+    if (len <= 0)
+        return QString();
+
+    // .../snap.firefox.firefox-<uuid>.scope maps to firefox_firefox.desktop
+    const char *end = buf + len;
+    const char *scope = findBytes(buf, end, "/snap.");
+    if (!scope)
+        return QString();
+
+    const char *snap = scope + 6;
+    const char *dot = static_cast<const char *>(memchr(snap, '.', end - snap));
+    if (!dot || dot == snap)
+        return QString();
+
+    const char *app = dot + 1;
+    const char *stop = app;
+    while (stop < end && *stop != '\n')
+        ++stop;
+
+    // App names may contain '-', so strip only the "-<uuid>.scope" tail.
+    static const int uuidLength = 36;
+    static const char scopeSuffix[] = ".scope";
+    const int suffixLength = sizeof(scopeSuffix) - 1;
+    if (stop - app < suffixLength || memcmp(stop - suffixLength, scopeSuffix, suffixLength) != 0)
+        return QString();
+    stop -= suffixLength;
+
+    if (stop - app > uuidLength + 1) {
+        const char *uuid = stop - uuidLength;
+        bool isUuid = uuid[-1] == '-' || uuid[-1] == '.';
+        for (int i = 0; isUuid && i < uuidLength; ++i) {
+            const bool dash = i == 8 || i == 13 || i == 18 || i == 23;
+            isUuid = dash ? uuid[i] == '-' : isxdigit(static_cast<unsigned char>(uuid[i]));
+        }
+        if (isUuid)
+            stop = uuid - 1;
+    }
+
+    if (stop == app)
+        return QString();
+
+    return QString::fromLatin1(snap, dot - snap) + '_' + QString::fromLatin1(app, stop - app);
+}
+
 CApplications *CApplications::self()
 {
     if (!SELF)
@@ -50,9 +218,22 @@ CApplications *CApplications::self()
 CApplications::CApplications(QObject *parent)
     : QObject(parent)
     , m_watcher(new QFileSystemWatcher(this))
+    , m_processCache(s_processCacheSize)
 {
-    m_watcher->addPath(s_systemAppFolder);
-    connect(m_watcher, &QFileSystemWatcher::directoryChanged, this, &CApplications::refresh);
+    for (const QString &folder : applicationFolders()) {
+        if (QDir(folder).exists())
+            m_watcher->addPath(folder);
+    }
+
+    m_refreshTimer.setSingleShot(true);
+    connect(&m_refreshTimer, &QTimer::timeout, this, &CApplications::refresh);
+
+    connect(m_watcher, &QFileSystemWatcher::directoryChanged, this, &CApplications::scheduleRefresh);
+    connect(EcoMode::self(), &EcoMode::enabledChanged, this, [=] {
+        // Catch up on changes held back while saving power.
+        if (m_refreshTimer.isActive())
+            scheduleRefresh();
+    });
     refresh();
 }
 
@@ -73,15 +254,20 @@ CAppItem *CApplications::find(const QString &fileName)
 
 CAppItem *CApplications::matchItem(quint32 pid, const QString &windowClass)
 {
-    QStringList commands = commandFromPid(pid);
+    CProcessIdentity process;
 
-    // The value returned from the commandFromPid() may be empty.
-    // Calling first() and last() below will cause the statusbar to crash.
-    if (commands.isEmpty() || windowClass.isEmpty())
+    if (!processIdentity(pid, process) || windowClass.isEmpty())
         return nullptr;
 
-    QString command = commands.first();
-    QString commandName = commands.last();
+    // Sandboxed apps know their desktop entry, no need to guess.
+    if (!process.appId.isEmpty()) {
+        for (CAppItem *item : std::as_const(m_items))
+            if (item->desktopId == process.appId)
+                return item;
+    }
+
+    const QString &command = process.command;
+    const QString &commandName = process.name;
 
     if (command.isEmpty())
         return nullptr;
@@ -126,23 +312,31 @@ CAppItem *CApplications::matchItem(quint32 pid, const QString &windowClass)
     return nullptr;
 }
 
+void CApplications::scheduleRefresh()
+{
+    // Package installs touch the folders many times in a row.
+    m_refreshTimer.start(EcoMode::self()->rescanDelay());
+}
+
 void CApplications::refresh()
 {
     QStringList addedEntries;
-    for (CAppItem *item : qAsConst(m_items)) {
+    for (CAppItem *item : std::as_const(m_items)) {
         addedEntries.append(item->path);
     }
 
     QStringList allEntries;
-    QDirIterator it(s_systemAppFolder, { "*.desktop" }, QDir::NoFilter, QDirIterator::Subdirectories);
+    for (const QString &folder : applicationFolders()) {
+        QDirIterator it(folder, { "*.desktop" }, QDir::NoFilter, QDirIterator::Subdirectories);
 
-    while (it.hasNext()) {
-        const QString &filePath = it.next();
+        while (it.hasNext()) {
+            const QString &filePath = it.next();
 
-        if (!QFile::exists(filePath))
-            continue;
+            if (!QFile::exists(filePath))
+                continue;
 
-        allEntries.append(filePath);
+            allEntries.append(filePath);
+        }
     }
 
     for (const QString &filePath : allEntries) {
@@ -152,7 +346,7 @@ void CApplications::refresh()
     }
 
     QList<CAppItem *> removeItems;
-    for (CAppItem *item : qAsConst(m_items)) {
+    for (CAppItem *item : std::as_const(m_items)) {
         if (!allEntries.contains(item->path)) {
             removeItems.append(item);
         }
@@ -166,6 +360,8 @@ void CApplications::addApplication(const QString &filePath)
     if (find(filePath))
         return;
 
+    BlockingSection section("file", filePath);
+    TraceSpan span("file", "parse desktop file", [&] { return QVariantMap {{"path", filePath}}; });
     QSettings desktop(filePath, QSettings::IniFormat);
     desktop.beginGroup("Desktop Entry");
 
@@ -204,6 +400,7 @@ void CApplications::addApplication(const QString &filePath)
     item->fullExec = desktop.value("Exec").toString();
     item->exec = simplifiedExec;
     item->fileName = QFileInfo(filePath).baseName();
+    item->desktopId = QFileInfo(filePath).completeBaseName();
     item->startupWMClass = desktop.value("StartupWMClass").toString();
     m_items.append(item);
 }
@@ -226,41 +423,64 @@ void CApplications::removeApplications(QList<CAppItem *> items)
     }
 }
 
-QStringList CApplications::commandFromPid(quint32 pid)
+bool CApplications::processIdentity(quint32 pid, CProcessIdentity &identity)
 {
-    QFile file(QString("/proc/%1/cmdline").arg(pid));
-
-    if (file.open(QIODevice::ReadOnly)) {
-        QByteArray cmd = file.readAll();
+    const quint64 startTime = processStartTime(pid);
 
-        // ref: https://github.com/KDE/kcoreaddons/blob/230c98aa7e01f9e36a9c2776f3633182e6778002/src/lib/util/kprocesslist_unix.cpp#L137
-        if (!cmd.isEmpty()) {
-            // extract non-truncated name from cmdline
-            int zeroIndex = cmd.indexOf('\0');
-            int processNameStart = cmd.lastIndexOf('/', zeroIndex);
-            if (processNameStart == -1) {
-                processNameStart = 0;
-            } else {
-                processNameStart++;
-            }
-
-            QString name = QString::fromLocal8Bit(cmd.mid(processNameStart, zeroIndex - processNameStart));
-
-            // reion: Remove parameters
-            name = name.split(' ').first();
+    if (startTime == 0) {
+        m_processCache.remove(pid);
+        return false;
+    }
 
-            cmd.replace('\0', ' ');
-            QString command = QString::fromLocal8Bit(cmd).trimmed();
+    // A matching start time means the pid has not been reused since we cached it.
+    if (CProcessIdentity *cached = m_processCache.object(pid)) {
+        if (cached->startTime == startTime) {
+            identity = *cached;
+            return true;
+        }
+    }
 
-            // There may be parameters.
-            if (command.split(' ').size() > 1) {
-                command = command.split(' ').first();
-            }
+    char buf[4096];
+    const qint64 len = readProcFile(pid, "cmdline", buf, sizeof(buf));
 
-            return { command, name };
-        }
+    if (len <= 0) {
+        m_processCache.remove(pid);
+        return false;
     }
 
-    return QStringList();
+    // ref: https://github.com/KDE/kcoreaddons/blob/230c98aa7e01f9e36a9c2776f3633182e6778002/src/lib/util/kprocesslist_unix.cpp#L137
+    // Only argv[0] is of interest, scan it in place instead of splitting copies.
+    const char *end = static_cast<const char *>(memchr(buf, '\0', len));
+    if (!end)
+        end = buf + len;
+
+    // Command: argv[0] up to the first space, some apps rewrite their cmdline.
+    const char *commandBegin = buf;
+    while (commandBegin < end && *commandBegin == ' ')
+        ++commandBegin;
+    const char *commandEnd = commandBegin;
+    while (commandEnd < end && *commandEnd != ' ')
+        ++commandEnd;
+
+    // Name: non-truncated process name after the last '/', without parameters.
+    const char *nameBegin = end;
+    while (nameBegin > buf && *(nameBegin - 1) != '/')
+        --nameBegin;
+    const char *nameEnd = nameBegin;
+    while (nameEnd < end && *nameEnd != ' ')
+        ++nameEnd;
+
+    CProcessIdentity *process = new CProcessIdentity;
+    process->startTime = startTime;
+    process->command = QString::fromLocal8Bit(commandBegin, commandEnd - commandBegin);
+    process->name = QString::fromLocal8Bit(nameBegin, nameEnd - nameBegin);
+    process->appId = flatpakAppId(pid);
+
+    if (process->appId.isEmpty())
+        process->appId = snapDesktopName(pid);
+
+    identity = *process;
+    m_processCache.insert(pid, process);
+
+    return true;
 }
-
@@ -21,6 +21,8 @@
 #define CAPPLICATIONS_H
 
 #include <QObject>
+#include <QCache>
+#include <QTimer>
 #include <QFileSystemWatcher>
 
 class CAppItem
@@ -34,9 +36,21 @@ public:
     QString fullExec;
     QString exec;
     QString fileName;
+    QString desktopId;
     QString startupWMClass;
 };
 
+class CProcessIdentity
+{
+public:
+    quint64 startTime = 0;
+    QString command;
+    QString name;
+
+    // Flatpak application id or Snap desktop name, empty for host apps.
+    QString appId;
+};
+
 class CApplications : public QObject
 {
     Q_OBJECT
@@ -49,17 +63,24 @@ public:
     CAppItem *find(const QString &fileName);
     CAppItem *matchItem(quint32 pid, const QString &windowClass);
 
+private slots:
+    void scheduleRefresh();
+
 private:
     void refresh();
     void addApplication(const QString &filePath);
     void removeApplication(CAppItem *item);
     void removeApplications(QList<CAppItem *> items);
 
-    QStringList commandFromPid(quint32 pid);
+    bool processIdentity(quint32 pid, CProcessIdentity &identity);
 
 private:
     QFileSystemWatcher *m_watcher;
+    QTimer m_refreshTimer;
     QList<CAppItem *> m_items;
+    QCache<quint32, CProcessIdentity> m_processCache;
+
+    friend class StatusBarBenchmark;
 };
 
 #endif // CAPPLICATIONS_H
@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2021 CutefishOS Team.
+ *
+ * Author:     cutefishos <cutefishos@foxmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "clock.h"
+#include "ecomode.h"
+
+#include <QDateTime>
+#include <QDBusConnection>
+#include <QFileSystemWatcher>
+#include <QFile>
+
+#include <time.h>
+
+static const QString s_localtime = QStringLiteral("/etc/localtime");
+
+static Clock *SELF = nullptr;
+
+Clock *Clock::self()
+{
+    if (!SELF)
+        SELF = new Clock;
+
+    return SELF;
+}
+
+Clock *Clock::create(QQmlEngine *, QJSEngine *)
+{
+    // Shared with the C++ side, the engine must not take ownership.
+    QJSEngine::setObjectOwnership(self(), QJSEngine::CppOwnership);
+    return self();
+}
+
+Clock::Clock(QObject *parent)
+    : QObject(parent)
+    , m_localtimeWatcher(new QFileSystemWatcher(this))
+    , m_showSeconds(false)
+{
+    m_timer.setSingleShot(true);
+    m_timer.setTimerType(Qt::PreciseTimer);
+    connect(&m_timer, &QTimer::timeout, this, &Clock::update);
+
+    // The monotonic timer is off by the time spent suspended.
+    QDBusConnection::systemBus().connect("org.freedesktop.login1",
+                                         "/org/freedesktop/login1",
+                                         "org.freedesktop.login1.Manager",
+                                         "PrepareForSleep", this, SLOT(onPrepareForSleep(bool)));
+
+    QDBusConnection::systemBus().connect("org.freedesktop.timedate1",
+                                         "/org/freedesktop/timedate1",
+                                         "org.freedesktop.DBus.Properties",
+                                         "PropertiesChanged", this, SLOT(onTimeZoneChanged()));
+
+    if (QFile::exists(s_localtime))
+        m_localtimeWatcher->addPath(s_localtime);
+    connect(m_localtimeWatcher, &QFileSystemWatcher::fileChanged, this, &Clock::onTimeZoneChanged);
+
+    connect(EcoMode::self(), &EcoMode::enabledChanged, this, &Clock::update);
+
+    setTwentyFourTime(false);
+}
+
+QString Clock::time() const
+{
+    return m_time;
+}
+
+QString Clock::date() const
+{
+    return m_date;
+}
+
+void Clock::setTwentyFourTime(bool enabled)
+{
+    m_timeFormat = enabled ? QStringLiteral("HH:mm") : m_locale.timeFormat(QLocale::ShortFormat);
+    m_showSeconds = m_timeFormat.contains(QLatin1Char('s'));
+
+    update();
+}
+
+void Clock::update()
+{
+    const QDateTime now = QDateTime::currentDateTime();
+
+    const QString time = m_locale.toString(now.time(), m_timeFormat);
+    if (m_time != time) {
+        m_time = time;
+        emit timeChanged();
+    }
+
+    // Only format the date when the day actually changed.
+    if (m_currentDate != now.date()) {
+        m_currentDate = now.date();
+        m_date = m_locale.toString(m_currentDate, QLocale::LongFormat);
+        emit dateChanged();
+    }
+
+    schedule();
+}
+
+void Clock::onPrepareForSleep(bool beforeSleep)
+{
+    if (beforeSleep)
+        m_timer.stop();
+    else
+        update();
+}
+
+void Clock::onTimeZoneChanged()
+{
+    // Make libc reread the zone before we format again.
+    ::tzset();
+
+    // The file is usually replaced rather than written to.
+    if (!m_localtimeWatcher->files().contains(s_localtime) && QFile::exists(s_localtime))
+        m_localtimeWatcher->addPath(s_localtime);
+
+    m_currentDate = QDate();
+    update();
+}
+
+void Clock::schedule()
+{
+    // Fire right after the next second or minute boundary, the day
+    // boundary is always a minute boundary as well.
+    const qint64 msecs = QDateTime::currentMSecsSinceEpoch();
+    const bool seconds = m_showSeconds && EcoMode::self()->clockSeconds();
+    const qint64 period = seconds ? 1000 : 60 * 1000;
+
+    m_timer.start(int(period - msecs % period) + 5);
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2021 CutefishOS Team.
+ *
+ * Author:     cutefishos <cutefishos@foxmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <QObject>
+#include <QTimer>
+#include <QLocale>
+#include <QDate>
+#include <QQmlEngine>
+
+class QFileSystemWatcher;
+
+class Clock : public QObject
+{
+    Q_OBJECT
+    QML_ELEMENT
+    QML_SINGLETON
+    Q_PROPERTY(QString time READ time NOTIFY timeChanged)
+    Q_PROPERTY(QString date READ date NOTIFY dateChanged)
+
+public:
+    static Clock *self();
+    static Clock *create(QQmlEngine *, QJSEngine *);
+    explicit Clock(QObject *parent = nullptr);
+
+    QString time() const;
+    QString date() const;
+
+    void setTwentyFourTime(bool enabled);
+
+signals:
+    void timeChanged();
+    void dateChanged();
+
+private slots:
+    void update();
+    void onPrepareForSleep(bool beforeSleep);
+    void onTimeZoneChanged();
+
+private:
+    void schedule();
+
+private:
+    QTimer m_timer;
+    QLocale m_locale;
+    QFileSystemWatcher *m_localtimeWatcher;
+
+    QString m_timeFormat;
+    bool m_showSeconds;
+
+    QString m_time;
+    QString m_date;
+    QDate m_currentDate;
+};
+
+#endif // CLOCK_H
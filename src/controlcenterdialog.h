@@ -22,10 +22,12 @@
 
 #include <QQuickWindow>
 #include <QTimer>
+#include <QQmlEngine>
 
 class ControlCenterDialog : public QQuickWindow
 {
     Q_OBJECT
+    QML_ELEMENT
 
 public:
     ControlCenterDialog(QQuickWindow *view = nullptr);
@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2021 CutefishOS Team.
+ *
+ * Author:     cutefishos <cutefishos@foxmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "dbusmenuregistry.h"
+#include "libdbusmenuqt/dbusmenuimporter.h"
+
+#include <QDBusConnection>
+#include <QDBusServiceWatcher>
+#include <QMenu>
+
+#include <utility>
+
+static const int s_maxIdle = 8;
+
+static DBusMenuRegistry *SELF = nullptr;
+
+DBusMenuRegistry *DBusMenuRegistry::self()
+{
+    if (!SELF)
+        SELF = new DBusMenuRegistry;
+
+    return SELF;
+}
+
+DBusMenuRegistry::DBusMenuRegistry(QObject *parent)
+    : QObject(parent)
+    , m_serviceWatcher(new QDBusServiceWatcher(QString(), QDBusConnection::sessionBus(),
+                                               QDBusServiceWatcher::WatchForUnregistration, this))
+{
+    connect(m_serviceWatcher, &QDBusServiceWatcher::serviceUnregistered,
+            this, &DBusMenuRegistry::onServiceUnregistered);
+}
+
+void DBusMenuRegistry::release(DBusMenuImporter *importer)
+{
+    if (!importer)
+        return;
+
+    for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+        if (it->importer != importer)
+            continue;
+
+        if (--it->refs > 0)
+            return;
+
+        const QString key = it.key();
+        m_idle.append(key);
+
+        while (m_idle.size() > s_maxIdle)
+            evict(m_idle.first());
+
+        return;
+    }
+
+    // Its service went away while it was in use.
+    importer->deleteLater();
+}
+
+bool DBusMenuRegistry::isWarm(DBusMenuImporter *importer)
+{
+    return importer && !importer->menu()->actions().isEmpty();
+}
+
+DBusMenuImporter *DBusMenuRegistry::find(const QString &key)
+{
+    auto it = m_entries.find(key);
+
+    if (it == m_entries.end())
+        return nullptr;
+
+    if (it->refs++ == 0)
+        m_idle.removeOne(key);
+
+    return it->importer;
+}
+
+void DBusMenuRegistry::insert(const QString &key, const QString &service, DBusMenuImporter *importer)
+{
+    m_entries.insert(key, { importer, service, 1 });
+
+    if (!m_serviceWatcher->watchedServices().contains(service))
+        m_serviceWatcher->addWatchedService(service);
+}
+
+void DBusMenuRegistry::evict(const QString &key)
+{
+    const Entry entry = m_entries.take(key);
+    m_idle.removeOne(key);
+
+    if (entry.importer)
+        entry.importer->deleteLater();
+
+    for (const Entry &other : std::as_const(m_entries)) {
+        if (other.service == entry.service)
+            return;
+    }
+
+    m_serviceWatcher->removeWatchedService(entry.service);
+}
+
+void DBusMenuRegistry::onServiceUnregistered(const QString &service)
+{
+    for (const QString &key : m_entries.keys()) {
+        const Entry entry = m_entries.value(key);
+
+        if (entry.service != service)
+            continue;
+
+        // Importers in use are deleted on their release().
+        if (entry.refs > 0)
+            m_entries.remove(key);
+        else
+            evict(key);
+    }
+
+    m_serviceWatcher->removeWatchedService(service);
+}
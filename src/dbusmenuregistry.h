@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2021 CutefishOS Team.
+ *
+ * Author:     cutefishos <cutefishos@foxmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DBUSMENUREGISTRY_H
+#define DBUSMENUREGISTRY_H
+
+#include <QObject>
+#include <QHash>
+#include <QStringList>
+
+#include <typeinfo>
+
+class DBusMenuImporter;
+class QDBusServiceWatcher;
+
+/**
+ * Process-wide DBusMenuImporters, one per menu and importer class.
+ *
+ * Importers that are no longer used stay alive for a while. They keep
+ * following LayoutUpdated, so switching back to a recently used window gets
+ * a complete menu without a round trip. They are dropped when their service
+ * leaves the bus or when more than s_maxIdle are kept.
+ */
+class DBusMenuRegistry : public QObject
+{
+    Q_OBJECT
+
+public:
+    static DBusMenuRegistry *self();
+
+    // Every acquire() must be paired with a release(), never delete the importer.
+    template<class Importer>
+    Importer *acquire(const QString &service, const QString &path)
+    {
+        const QString key = QString::fromLatin1(typeid(Importer).name()) + service + path;
+
+        if (DBusMenuImporter *importer = find(key))
+            return static_cast<Importer *>(importer);
+
+        Importer *importer = new Importer(service, path, this);
+        insert(key, service, importer);
+        return importer;
+    }
+
+    void release(DBusMenuImporter *importer);
+
+    // Whether the menu has been fetched already and can be shown right away.
+    static bool isWarm(DBusMenuImporter *importer);
+
+private:
+    explicit DBusMenuRegistry(QObject *parent = nullptr);
+
+    DBusMenuImporter *find(const QString &key);
+    void insert(const QString &key, const QString &service, DBusMenuImporter *importer);
+    void evict(const QString &key);
+    void onServiceUnregistered(const QString &service);
+
+private:
+    struct Entry {
+        DBusMenuImporter *importer;
+        QString service;
+        int refs;
+    };
+
+    QHash<QString, Entry> m_entries;
+    // Unused entries, least recently used first.
+    QStringList m_idle;
+    QDBusServiceWatcher *m_serviceWatcher;
+};
+
+#endif // DBUSMENUREGISTRY_H
@@ -0,0 +1,194 @@
+/*
+ * Copyright (C) 2021 CutefishOS Team.
+ *
+ * Author:     cutefishos <cutefishos@foxmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "dbuspropertycache.h"
+#include "startupprofiler.h"
+#include "wakeupmonitor.h"
+#include "tracer.h"
+
+#include <QDBusArgument>
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
+#include <QDBusServiceWatcher>
+#include <QDBusVariant>
+#include <QDebug>
+
+static const QString s_propertiesInterface = QStringLiteral("org.freedesktop.DBus.Properties");
+
+DBusPropertyCache::DBusPropertyCache(const QString &service,
+                                     const QString &path,
+                                     const QString &interface,
+                                     const QDBusConnection &connection,
+                                     QObject *parent)
+    : QObject(parent)
+    , m_service(service)
+    , m_path(path)
+    , m_interface(interface)
+    , m_connection(connection)
+    , m_serviceWatcher(new QDBusServiceWatcher(service, connection,
+                                               QDBusServiceWatcher::WatchForRegistration, this))
+    , m_ready(false)
+{
+    m_connection.connect(m_service, m_path, s_propertiesInterface, "PropertiesChanged", this,
+                         SLOT(onPropertiesChanged(QString, QVariantMap, QStringList, QDBusMessage)));
+
+    // The backend may start after us or restart, fetch everything again.
+    connect(m_serviceWatcher, &QDBusServiceWatcher::serviceRegistered, this, &DBusPropertyCache::refresh);
+
+    refresh();
+}
+
+bool DBusPropertyCache::isReady() const
+{
+    return m_ready;
+}
+
+QVariant DBusPropertyCache::value(const QString &name, const QVariant &defaultValue) const
+{
+    return m_values.value(name, defaultValue);
+}
+
+void DBusPropertyCache::setCachedValue(const QString &name, const QVariant &value)
+{
+    update(name, value, false);
+}
+
+void DBusPropertyCache::setHeld(const QString &name, bool held)
+{
+    if (held)
+        m_held.insert(name);
+    else
+        m_held.remove(name);
+}
+
+void DBusPropertyCache::watchSignal(const QString &signal, const QString &property)
+{
+    if (m_signals.contains(signal))
+        return;
+
+    m_signals.insert(signal, property);
+    m_connection.connect(m_service, m_path, m_interface, signal, this, SLOT(onWatchedSignal(QDBusMessage)));
+}
+
+void DBusPropertyCache::refresh()
+{
+    QDBusMessage msg = QDBusMessage::createMethodCall(m_service, m_path, s_propertiesInterface, "GetAll");
+    msg << m_interface;
+
+    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(m_connection.asyncCall(msg), this);
+    connect(watcher, &QDBusPendingCallWatcher::finished, this, &DBusPropertyCache::onGetAllFinished);
+    Tracer::asyncCall(watcher, "GetAll", m_service, m_path);
+}
+
+void DBusPropertyCache::refreshProperty(const QString &name)
+{
+    QDBusMessage msg = QDBusMessage::createMethodCall(m_service, m_path, s_propertiesInterface, "Get");
+    msg << m_interface << name;
+
+    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(m_connection.asyncCall(msg), this);
+    connect(watcher, &QDBusPendingCallWatcher::finished, this, [this, name] (QDBusPendingCallWatcher *w) {
+        QDBusPendingReply<QDBusVariant> reply = *w;
+
+        if (!reply.isError())
+            update(name, reply.value().variant());
+
+        w->deleteLater();
+    });
+}
+
+QDBusPendingCall DBusPropertyCache::asyncCall(const QString &method, const QVariantList &args) const
+{
+    QDBusMessage msg = QDBusMessage::createMethodCall(m_service, m_path, m_interface, method);
+    msg.setArguments(args);
+    return m_connection.asyncCall(msg);
+}
+
+void DBusPropertyCache::onPropertiesChanged(const QString &interface, const QVariantMap &changed, const QStringList &invalidated,
+                                            const QDBusMessage &message)
+{
+    WakeupMonitor::dbusMessage(message.service(), message.member());
+
+    if (interface != m_interface)
+        return;
+
+    for (auto it = changed.constBegin(); it != changed.constEnd(); ++it)
+        update(it.key(), it.value());
+
+    for (const QString &name : invalidated)
+        refreshProperty(name);
+}
+
+void DBusPropertyCache::onWatchedSignal(const QDBusMessage &message)
+{
+    WakeupMonitor::dbusMessage(message.service(), message.member());
+
+    const QString property = m_signals.value(message.member());
+
+    if (property.isEmpty())
+        return;
+
+    const QVariantList args = message.arguments();
+
+    if (message.member() == property + QLatin1String("Changed") && !args.isEmpty())
+        update(property, args.first());
+    else
+        refreshProperty(property);
+}
+
+void DBusPropertyCache::onGetAllFinished(QDBusPendingCallWatcher *watcher)
+{
+    QDBusPendingReply<QVariantMap> reply = *watcher;
+    watcher->deleteLater();
+
+    WakeupMonitor::dbusMessage(m_service, QStringLiteral("GetAll"));
+
+    if (reply.isError()) {
+        qDebug() << "DBusPropertyCache:" << m_service << m_path << reply.error().message();
+        return;
+    }
+
+    const QVariantMap values = reply.value();
+    for (auto it = values.constBegin(); it != values.constEnd(); ++it)
+        update(it.key(), it.value());
+
+    if (!m_ready) {
+        m_ready = true;
+        StartupProfiler::mark(QStringLiteral("backend ") + m_path);
+        emit ready();
+    }
+}
+
+void DBusPropertyCache::update(const QString &name, const QVariant &value, bool remote)
+{
+    if (remote && m_held.contains(name))
+        return;
+
+    QVariant v = value;
+
+    // Nested variants arrive wrapped when the signature is "v".
+    if (v.userType() == qMetaTypeId<QDBusVariant>())
+        v = v.value<QDBusVariant>().variant();
+
+    auto it = m_values.find(name);
+    if (it != m_values.end() && *it == v)
+        return;
+
+    m_values.insert(name, v);
+    emit propertyChanged(name, v);
+}
@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2021 CutefishOS Team.
+ *
+ * Author:     cutefishos <cutefishos@foxmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DBUSPROPERTYCACHE_H
+#define DBUSPROPERTYCACHE_H
+
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QVariant>
+#include <QDBusConnection>
+#include <QDBusMessage>
+#include <QDBusPendingCall>
+
+class QDBusPendingCallWatcher;
+class QDBusServiceWatcher;
+
+/**
+ * In-memory copy of the properties of one DBus interface.
+ *
+ * Values are fetched with a single asynchronous GetAll and afterwards kept up
+ * to date from PropertiesChanged and the backend's own "*Changed" signals, so
+ * reading a property never leaves the process.
+ */
+class DBusPropertyCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DBusPropertyCache(const QString &service,
+                               const QString &path,
+                               const QString &interface,
+                               const QDBusConnection &connection = QDBusConnection::sessionBus(),
+                               QObject *parent = nullptr);
+
+    bool isReady() const;
+
+    QVariant value(const QString &name, const QVariant &defaultValue = QVariant()) const;
+
+    // Store a value locally before the backend confirms it.
+    void setCachedValue(const QString &name, const QVariant &value);
+
+    // While held, values coming from the backend for this property are dropped.
+    void setHeld(const QString &name, bool held);
+
+    // A signal named <property>Changed with an argument carries the new value,
+    // anything else makes the cache re-read the property.
+    void watchSignal(const QString &signal, const QString &property);
+
+    void refresh();
+    void refreshProperty(const QString &name);
+
+    QDBusPendingCall asyncCall(const QString &method, const QVariantList &args = QVariantList()) const;
+
+    QString service() const { return m_service; }
+    QString path() const { return m_path; }
+    QString interface() const { return m_interface; }
+    QDBusConnection connection() const { return m_connection; }
+
+signals:
+    void ready();
+    void propertyChanged(const QString &name, const QVariant &value);
+
+private slots:
+    void onPropertiesChanged(const QString &interface, const QVariantMap &changed, const QStringList &invalidated,
+                             const QDBusMessage &message);
+    void onWatchedSignal(const QDBusMessage &message);
+    void onGetAllFinished(QDBusPendingCallWatcher *watcher);
+
+private:
+    void update(const QString &name, const QVariant &value, bool remote = true);
+
+private:
+    QString m_service;
+    QString m_path;
+    QString m_interface;
+    QDBusConnection m_connection;
+    QDBusServiceWatcher *m_serviceWatcher;
+
+    QVariantMap m_values;
+    QHash<QString, QString> m_signals;
+    QSet<QString> m_held;
+    bool m_ready;
+};
+
+#endif // DBUSPROPERTYCACHE_H
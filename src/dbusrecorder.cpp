@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2021 CutefishOS Team.
+ *
+ * Author:     cutefishos <cutefishos@foxmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "dbusrecorder.h"
+
+#include <QCoreApplication>
+#include <QDBusConnection>
+#include <QDBusMessage>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QProcess>
+#include <QThread>
+#include <QDebug>
+
+// The pcap file header, dbus-monitor writes it before the first message.
+static const qint64 s_pcapHeaderSize = 24;
+static const int s_attachTimeout = 2000;
+
+static QProcess *s_monitor = nullptr;
+
+static void stop()
+{
+    // dbus-monitor flushes every message, SIGTERM loses nothing.
+    s_monitor->terminate();
+    s_monitor->waitForFinished(1000);
+}
+
+void DBusRecorder::start()
+{
+    const QString fileName = qEnvironmentVariable("CUTEFISH_STATUSBAR_RECORD");
+
+    if (fileName.isEmpty())
+        return;
+
+    const QString self = QDBusConnection::sessionBus().baseService();
+
+    if (self.isEmpty()) {
+        qWarning() << "StatusBar: no session bus, nothing to record";
+        return;
+    }
+
+    // Broadcast signals have no destination. Only those the bar subscribes
+    // to are kept: by sender for the desktop services and for name owner
+    // changes, which drive the service watchers, and by interface for tray
+    // items, application menus and media players. Other traffic on the bus
+    // stays out of the file.
+    const QStringList rules = {
+        QString("sender='%1'").arg(self),
+        QString("destination='%1'").arg(self),
+        QStringLiteral("type='signal',sender='org.freedesktop.DBus',member='NameOwnerChanged'"),
+        QStringLiteral("type='signal',sender='com.cutefish.Settings'"),
+        QStringLiteral("type='signal',sender='com.cutefish.Notification'"),
+        QStringLiteral("type='signal',sender='com.cutefish.Session'"),
+        QStringLiteral("type='signal',interface='org.kde.StatusNotifierItem'"),
+        QStringLiteral("type='signal',interface='com.canonical.dbusmenu'"),
+        QStringLiteral("type='signal',interface='org.mpris.MediaPlayer2.Player'"),
+        QStringLiteral("type='signal',interface='org.freedesktop.DBus.Properties',"
+                       "member='PropertiesChanged',path='/org/mpris/MediaPlayer2'"),
+    };
+
+    s_monitor = new QProcess(qApp);
+    s_monitor->setStandardOutputFile(fileName, QIODevice::Truncate);
+    s_monitor->setProcessChannelMode(QProcess::ForwardedErrorChannel);
+    s_monitor->start(QStringLiteral("dbus-monitor"),
+                     QStringList { QStringLiteral("--session"), QStringLiteral("--pcap") } + rules);
+
+    if (!s_monitor->waitForStarted()) {
+        qWarning() << "StatusBar: cannot start dbus-monitor:" << s_monitor->errorString();
+        delete s_monitor;
+        s_monitor = nullptr;
+        return;
+    }
+
+    // Started only means dbus-monitor was exec'd. Ping the bus until the ping
+    // shows up in the file, from then on the monitor sees the bar's traffic.
+    const QDBusMessage ping = QDBusMessage::createMethodCall(QStringLiteral("org.freedesktop.DBus"),
+                                                             QStringLiteral("/org/freedesktop/DBus"),
+                                                             QStringLiteral("org.freedesktop.DBus.Peer"),
+                                                             QStringLiteral("Ping"));
+    QElapsedTimer attaching;
+    attaching.start();
+
+    while (QFileInfo(fileName).size() <= s_pcapHeaderSize) {
+        if (attaching.elapsed() > s_attachTimeout || s_monitor->state() != QProcess::Running) {
+            qWarning() << "StatusBar: dbus-monitor did not attach, the capture may miss startup traffic";
+            break;
+        }
+
+        QDBusConnection::sessionBus().call(ping);
+        QThread::msleep(10);
+    }
+
+    qAddPostRoutine(stop);
+
+    qDebug() << "StatusBar: recording DBus traffic of" << self << "to" << fileName;
+}
@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2021 CutefishOS Team.
+ *
+ * Author:     cutefishos <cutefishos@foxmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DBUSRECORDER_H
+#define DBUSRECORDER_H
+
+/**
+ * Captures the session bus traffic of the bar for statusbar_replay.
+ *
+ * With CUTEFISH_STATUSBAR_RECORD=<file> set, dbus-monitor writes every
+ * message sent by or to the bar, and the signals of the services it
+ * subscribes to, as pcap with timestamps. start() returns once the monitor
+ * is attached. The system bus is not captured.
+ */
+class DBusRecorder
+{
+public:
+    static void start();
+};
+
+#endif // DBUSRECORDER_H
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2021 CutefishOS Team.
+ *
+ * Author:     cutefishos <cutefishos@foxmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "dbuswritecoalescer.h"
+#include "dbuspropertycache.h"
+
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
+#include <QDebug>
+
+DBusWriteCoalescer::DBusWriteCoalescer(DBusPropertyCache *properties,
+                                       const QString &method,
+                                       const QString &property,
+                                       QObject *parent)
+    : QObject(parent)
+    , m_properties(properties)
+    , m_method(method)
+    , m_property(property)
+    , m_inFlight(false)
+{
+}
+
+void DBusWriteCoalescer::write(const QVariant &value)
+{
+    m_properties->setCachedValue(m_property, value);
+
+    if (m_inFlight) {
+        m_pending = value;
+        return;
+    }
+
+    m_properties->setHeld(m_property, true);
+    send(value);
+}
+
+bool DBusWriteCoalescer::isBusy() const
+{
+    return m_inFlight;
+}
+
+void DBusWriteCoalescer::onCallFinished(QDBusPendingCallWatcher *watcher)
+{
+    QDBusPendingReply<> reply = *watcher;
+    watcher->deleteLater();
+
+    if (reply.isError())
+        qWarning() << "DBusWriteCoalescer:" << m_method << reply.error().message();
+
+    m_inFlight = false;
+
+    if (m_pending.isValid()) {
+        const QVariant value = m_pending;
+        m_pending = QVariant();
+        send(value);
+        return;
+    }
+
+    // Settled, let the backend have the last word.
+    m_properties->setHeld(m_property, false);
+    m_properties->refreshProperty(m_property);
+
+    emit idle();
+}
+
+void DBusWriteCoalescer::send(const QVariant &value)
+{
+    m_inFlight = true;
+
+    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(m_properties->asyncCall(m_method, { value }), this);
+    connect(watcher, &QDBusPendingCallWatcher::finished, this, &DBusWriteCoalescer::onCallFinished);
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2021 CutefishOS Team.
+ *
+ * Author:     cutefishos <cutefishos@foxmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DBUSWRITECOALESCER_H
+#define DBUSWRITECOALESCER_H
+
+#include <QObject>
+#include <QVariant>
+
+class DBusPropertyCache;
+class QDBusPendingCallWatcher;
+
+/**
+ * Sends the setter of one property with at most one call in flight.
+ *
+ * Values written while a call is pending replace each other, only the latest
+ * one is sent once the reply arrives. The cache shows the written value right
+ * away and ignores backend notifications until the writes have settled, then
+ * re-reads the property to pick up what the backend actually applied.
+ */
+class DBusWriteCoalescer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DBusWriteCoalescer(DBusPropertyCache *properties,
+                                const QString &method,
+                                const QString &property,
+                                QObject *parent = nullptr);
+
+    void write(const QVariant &value);
+
+    bool isBusy() const;
+
+signals:
+    void idle();
+
+private slots:
+    void onCallFinished(QDBusPendingCallWatcher *watcher);
+
+private:
+    void send(const QVariant &value);
+
+private:
+    DBusPropertyCache *m_properties;
+    QString m_method;
+    QString m_property;
+
+    QVariant m_pending;
+    bool m_inFlight;
+};
+
+#endif // DBUSWRITECOALESCER_H
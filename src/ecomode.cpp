@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2021 CutefishOS Team.
+ *
+ * Author:     cutefishos <cutefishos@foxmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ecomode.h"
+#include "battery.h"
+
+static EcoMode *SELF = nullptr;
+
+EcoMode *EcoMode::self()
+{
+    if (!SELF)
+        SELF = new EcoMode;
+
+    return SELF;
+}
+
+EcoMode *EcoMode::create(QQmlEngine *, QJSEngine *)
+{
+    // Shared with the C++ side, the engine must not take ownership.
+    QJSEngine::setObjectOwnership(self(), QJSEngine::CppOwnership);
+    return self();
+}
+
+EcoMode::EcoMode(QObject *parent)
+    : QObject(parent)
+    , m_policy(Auto)
+    , m_enabled(false)
+{
+    connect(Battery::self(), &Battery::onBatteryChanged, this, &EcoMode::update);
+    update();
+}
+
+bool EcoMode::enabled() const
+{
+    return m_enabled;
+}
+
+EcoMode::Policy EcoMode::policy() const
+{
+    return m_policy;
+}
+
+void EcoMode::setPolicy(Policy policy)
+{
+    if (m_policy == policy)
+        return;
+
+    m_policy = policy;
+    update();
+}
+
+int EcoMode::trayRefreshInterval() const
+{
+    // Tray items that animate their icon would otherwise keep us busy.
+    return m_enabled ? 1000 : 10;
+}
+
+int EcoMode::rescanDelay() const
+{
+    return m_enabled ? 30 * 1000 : 0;
+}
+
+bool EcoMode::blurEnabled() const
+{
+    return !m_enabled;
+}
+
+bool EcoMode::animationsEnabled() const
+{
+    return !m_enabled;
+}
+
+bool EcoMode::clockSeconds() const
+{
+    return !m_enabled;
+}
+
+void EcoMode::update()
+{
+    bool enabled = false;
+
+    switch (m_policy) {
+    case Auto:
+        enabled = Battery::self()->onBattery();
+        break;
+    case On:
+        enabled = true;
+        break;
+    case Off:
+        enabled = false;
+        break;
+    }
+
+    if (m_enabled != enabled) {
+        m_enabled = enabled;
+        emit enabledChanged();
+    }
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2021 CutefishOS Team.
+ *
+ * Author:     cutefishos <cutefishos@foxmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ECOMODE_H
+#define ECOMODE_H
+
+#include <QObject>
+#include <QQmlEngine>
+
+/**
+ * Power saving policy shared by all parts of the bar.
+ *
+ * Follows UPower's OnBattery unless forced on or off over DBus. Subsystems
+ * read their settings from here and listen to enabledChanged.
+ */
+class EcoMode : public QObject
+{
+    Q_OBJECT
+    QML_ELEMENT
+    QML_SINGLETON
+    Q_PROPERTY(bool enabled READ enabled NOTIFY enabledChanged)
+    Q_PROPERTY(bool animationsEnabled READ animationsEnabled NOTIFY enabledChanged)
+
+public:
+    enum Policy {
+        Auto = 0,
+        On,
+        Off
+    };
+
+    static EcoMode *self();
+    static EcoMode *create(QQmlEngine *, QJSEngine *);
+    explicit EcoMode(QObject *parent = nullptr);
+
+    bool enabled() const;
+
+    Policy policy() const;
+    void setPolicy(Policy policy);
+
+    // Per-subsystem settings derived from the current mode.
+    int trayRefreshInterval() const;
+    int rescanDelay() const;
+    bool blurEnabled() const;
+    bool animationsEnabled() const;
+    bool clockSeconds() const;
+
+signals:
+    void enabledChanged();
+
+private slots:
+    void update();
+
+private:
+    Policy m_policy;
+    bool m_enabled;
+};
+
+#endif // ECOMODE_H
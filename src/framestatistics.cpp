@@ -0,0 +1,218 @@
+/*
+ * Copyright (C) 2021 CutefishOS Team.
+ *
+ * Author:     cutefishos <cutefishos@foxmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "framestatistics.h"
+#include "wakeupmonitor.h"
+
+#include <QQuickWindow>
+#include <QMutexLocker>
+
+#include <algorithm>
+
+// Frame times kept for the percentiles, and minutes kept for the counts.
+static const int s_keptFrames = 1024;
+static const int s_keptMinutes = 60;
+
+static FrameStatistics *SELF = nullptr;
+
+static double percentile(const QVector<qint64> &sorted, double p)
+{
+    if (sorted.isEmpty())
+        return 0;
+
+    const int index = qMin(sorted.size() - 1, int(p * sorted.size()));
+    return sorted.at(index) / 1000000.0;
+}
+
+FrameStatistics *FrameStatistics::self()
+{
+    if (!SELF)
+        SELF = new FrameStatistics;
+
+    return SELF;
+}
+
+FrameStatistics *FrameStatistics::create(QQmlEngine *, QJSEngine *)
+{
+    QJSEngine::setObjectOwnership(self(), QJSEngine::CppOwnership);
+    return self();
+}
+
+FrameStatistics::FrameStatistics(QObject *parent)
+    : QObject(parent)
+    , m_syncStart(-1)
+    , m_next(0)
+    , m_frames(0)
+    , m_minute(0)
+    , m_minutes(1, 0)
+    , m_overlayEnabled(qEnvironmentVariableIsSet("CUTEFISH_STATUSBAR_FRAME_OVERLAY"))
+    , m_wakeupsForOverlay(false)
+{
+    m_clock.start();
+    m_frameTimes.reserve(s_keptFrames);
+
+    // The overlay redraws the bar itself, keep that to once a second.
+    m_overlayTimer.setInterval(1000);
+    connect(&m_overlayTimer, &QTimer::timeout, this, [=] {
+        const QString summary = this->summary();
+        if (summary != m_summary) {
+            m_summary = summary;
+            emit summaryChanged();
+        }
+    });
+
+    if (m_overlayEnabled) {
+        m_overlayTimer.start();
+        setWakeupAttribution(true);
+    }
+}
+
+void FrameStatistics::watch(QQuickWindow *window)
+{
+    connect(window, &QQuickWindow::beforeSynchronizing, this, [=] {
+        QMutexLocker locker(&m_mutex);
+        m_syncStart = m_clock.nsecsElapsed();
+    }, Qt::DirectConnection);
+
+    connect(window, &QQuickWindow::afterRendering, this, [=] {
+        QMutexLocker locker(&m_mutex);
+
+        if (m_syncStart < 0)
+            return;
+
+        const qint64 frameTime = m_clock.nsecsElapsed() - m_syncStart;
+        m_syncStart = -1;
+
+        if (m_frameTimes.size() < s_keptFrames)
+            m_frameTimes.append(frameTime);
+        else
+            m_frameTimes[m_next] = frameTime;
+        m_next = (m_next + 1) % s_keptFrames;
+    }, Qt::DirectConnection);
+
+    connect(window, &QQuickWindow::frameSwapped, this, [=] {
+        QMutexLocker locker(&m_mutex);
+        rotate(m_clock.elapsed() / 60000);
+        ++m_frames;
+        ++m_minutes[0];
+    }, Qt::DirectConnection);
+
+    // Emitted on the GUI thread before each frame is synchronized.
+    connect(window, &QQuickWindow::afterAnimating, this, [=] {
+        WakeupMonitor *monitor = WakeupMonitor::self();
+        if (monitor->enabled())
+            ++m_sources[monitor->currentSource()];
+    });
+}
+
+QVariantMap FrameStatistics::statistics() const
+{
+    QVector<qint64> frameTimes;
+    QVariantList perMinute;
+    QVariantMap result;
+
+    {
+        QMutexLocker locker(&m_mutex);
+        frameTimes = m_frameTimes;
+        result["frames"] = m_frames;
+
+        // Minutes without frames have not been rotated in yet.
+        const qint64 idle = m_clock.elapsed() / 60000 - m_minute;
+        for (qint64 i = 0; i < idle && perMinute.size() < s_keptMinutes; ++i)
+            perMinute.append(0);
+        for (int i = 0; i < m_minutes.size() && perMinute.size() < s_keptMinutes; ++i)
+            perMinute.append(m_minutes.at(i));
+    }
+
+    std::sort(frameTimes.begin(), frameTimes.end());
+    result["p50"] = percentile(frameTimes, 0.50);
+    result["p95"] = percentile(frameTimes, 0.95);
+    result["p99"] = percentile(frameTimes, 0.99);
+    result["framesPerMinute"] = perMinute;
+
+    QVariantMap sources;
+    for (auto it = m_sources.constBegin(); it != m_sources.constEnd(); ++it)
+        sources.insert(it.key(), it.value());
+    result["sources"] = sources;
+
+    return result;
+}
+
+bool FrameStatistics::overlayEnabled() const
+{
+    return m_overlayEnabled;
+}
+
+void FrameStatistics::setOverlayEnabled(bool enabled)
+{
+    if (m_overlayEnabled == enabled)
+        return;
+
+    m_overlayEnabled = enabled;
+
+    if (enabled)
+        m_overlayTimer.start();
+    else
+        m_overlayTimer.stop();
+
+    setWakeupAttribution(enabled);
+
+    emit overlayEnabledChanged();
+}
+
+QString FrameStatistics::summary() const
+{
+    const QVariantMap stats = statistics();
+    const QVariantList perMinute = stats.value("framesPerMinute").toList();
+
+    return QString("%1 frames/min  p50 %2  p95 %3  p99 %4 ms")
+            .arg(perMinute.isEmpty() ? 0 : perMinute.first().toUInt())
+            .arg(stats.value("p50").toDouble(), 0, 'f', 1)
+            .arg(stats.value("p95").toDouble(), 0, 'f', 1)
+            .arg(stats.value("p99").toDouble(), 0, 'f', 1);
+}
+
+void FrameStatistics::rotate(qint64 minute)
+{
+    if (minute - m_minute > s_keptMinutes) {
+        m_minutes.fill(0);
+        m_minute = minute - s_keptMinutes;
+    }
+
+    while (m_minute < minute) {
+        m_minutes.prepend(0);
+        if (m_minutes.size() > s_keptMinutes)
+            m_minutes.removeLast();
+        ++m_minute;
+    }
+}
+
+void FrameStatistics::setWakeupAttribution(bool enabled)
+{
+    WakeupMonitor *monitor = WakeupMonitor::self();
+
+    // Leave the monitor alone when someone else turned it on.
+    if (enabled && !monitor->enabled()) {
+        monitor->setEnabled(true);
+        m_wakeupsForOverlay = true;
+    } else if (!enabled && m_wakeupsForOverlay) {
+        monitor->setEnabled(false);
+        m_wakeupsForOverlay = false;
+    }
+}
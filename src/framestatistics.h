@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2021 CutefishOS Team.
+ *
+ * Author:     cutefishos <cutefishos@foxmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FRAMESTATISTICS_H
+#define FRAMESTATISTICS_H
+
+#include <QObject>
+#include <QMutex>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QVariantMap>
+#include <QVector>
+#include <QHash>
+#include <QQmlEngine>
+
+class QQuickWindow;
+
+/**
+ * Frame times and frame counts of the bar window.
+ *
+ * Sync and render are timed on the render thread. Each frame is also
+ * attributed, on the GUI thread, to whatever woke the event loop for it,
+ * so an idle bar should show no frames at all. Attribution needs the
+ * WakeupMonitor, the overlay turns it on while it is shown.
+ */
+class FrameStatistics : public QObject
+{
+    Q_OBJECT
+    QML_ELEMENT
+    QML_SINGLETON
+    Q_PROPERTY(bool overlayEnabled READ overlayEnabled WRITE setOverlayEnabled NOTIFY overlayEnabledChanged)
+    Q_PROPERTY(QString summary READ summary NOTIFY summaryChanged)
+
+public:
+    static FrameStatistics *self();
+    static FrameStatistics *create(QQmlEngine *, QJSEngine *);
+
+    explicit FrameStatistics(QObject *parent = nullptr);
+
+    void watch(QQuickWindow *window);
+
+    // frames, p50/p95/p99 in ms, framesPerMinute and sources. Frames only
+    // count towards sources while the WakeupMonitor is enabled.
+    QVariantMap statistics() const;
+
+    bool overlayEnabled() const;
+    void setOverlayEnabled(bool enabled);
+
+    QString summary() const;
+
+signals:
+    void overlayEnabledChanged();
+    void summaryChanged();
+
+private:
+    void rotate(qint64 minute);
+    void setWakeupAttribution(bool enabled);
+
+private:
+    QElapsedTimer m_clock;
+
+    // Written from the render thread.
+    mutable QMutex m_mutex;
+    qint64 m_syncStart;
+    QVector<qint64> m_frameTimes;
+    int m_next;
+    quint64 m_frames;
+    qint64 m_minute;
+    QVector<quint32> m_minutes;
+
+    // GUI thread only.
+    QHash<QString, quint32> m_sources;
+    bool m_overlayEnabled;
+    bool m_wakeupsForOverlay;
+    QTimer m_overlayTimer;
+    QString m_summary;
+};
+
+#endif // FRAMESTATISTICS_H
@@ -20,6 +20,8 @@
 */
 
 #include "dbusmenuimporter.h"
+#include "../wakeupmonitor.h"
+#include "../tracer.h"
 
 // Qt
 #include <QCoreApplication>
@@ -29,10 +31,10 @@
 #include <QDBusVariant>
 #include <QDebug>
 #include <QFont>
+#include <QHash>
 #include <QMenu>
 #include <QPointer>
 #include <QSet>
-#include <QTime>
 #include <QTimer>
 #include <QToolButton>
 #include <QWidgetAction>
@@ -46,11 +48,6 @@
 // Generated
 #include "../appmenu/dbusmenu_interface.h"
 
-//#define BENCHMARK
-#ifdef BENCHMARK
-static QTime sChrono;
-#endif
-
 #define DMRETURN_IF_FAIL(cond)                                                                                                                                 \
     if (!(cond)) {                                                                                                                                             \
         qCWarning() << "Condition failed: " #cond;                                                                                                   \
@@ -91,12 +88,23 @@ public:
     QSet<int> m_idsRefreshedByAboutToShow;
     QSet<int> m_pendingLayoutUpdates;
 
+    // The imported layout. QActions only exist for the menus in m_populated,
+    // the root menu and submenus while they are open.
+    struct Node {
+        QVariantMap properties;
+        QList<int> children;
+        bool fetched = false;
+    };
+    QHash<int, Node> m_nodes;
+    QSet<int> m_populated;
+
     QDBusPendingCallWatcher *refresh(int id)
     {
         auto call = m_interface->GetLayout(id, 1, QStringList());
         QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(call, q);
         watcher->setProperty(DBUSMENU_PROPERTY_ID, id);
         QObject::connect(watcher, &QDBusPendingCallWatcher::finished, q, &DBusMenuImporter::slotGetLayoutFinished);
+        Tracer::asyncCall(watcher, "DBusMenu GetLayout", m_interface->service(), m_interface->path());
 
         return watcher;
     }
@@ -107,6 +115,120 @@ public:
         return menu;
     }
 
+    void storeLayout(int parentId, const DBusMenuLayoutItem &rootItem)
+    {
+        QList<int> children;
+        children.reserve(rootItem.children.count());
+
+        for (const DBusMenuLayoutItem &item : rootItem.children) {
+            children << item.id;
+            m_nodes[item.id].properties = item.properties;
+        }
+
+        const QSet<int> current(children.cbegin(), children.cend());
+        const QList<int> previous = m_nodes.value(parentId).children;
+        for (int id : previous) {
+            if (!current.contains(id)) {
+                removeNode(id);
+            }
+        }
+
+        Node &parent = m_nodes[parentId];
+        parent.children = children;
+        parent.fetched = true;
+    }
+
+    void removeNode(int id)
+    {
+        const Node node = m_nodes.take(id);
+        for (int child : node.children) {
+            removeNode(child);
+        }
+    }
+
+    /**
+     * Creates, updates and removes the actions of a menu so they match the
+     * stored layout. Submenus get an empty QMenu which is populated when it
+     * is about to show.
+     */
+    void populate(QMenu *menu, int parentId)
+    {
+        m_populated << parentId;
+        QObject::connect(menu, &QMenu::aboutToHide, q, &DBusMenuImporter::slotMenuAboutToHide, Qt::UniqueConnection);
+
+        const QList<int> children = m_nodes.value(parentId).children;
+
+        // remove outdated actions
+        const QSet<int> newDBusMenuItemIds(children.cbegin(), children.cend());
+        for (QAction *action : menu->actions()) {
+            int id = action->property(DBUSMENU_PROPERTY_ID).toInt();
+            if (!newDBusMenuItemIds.contains(id)) {
+                // Not calling removeAction() as QMenu will immediately close when it becomes empty,
+                // which can happen when an application completely reloads this menu.
+                // When the action is deleted deferred, it is removed from the menu.
+                action->deleteLater();
+                if (action->menu()) {
+                    releaseActions(action->menu());
+                    action->menu()->deleteLater();
+                }
+                m_actionForId.remove(id);
+            }
+        }
+
+        // insert or update new actions into our menu
+        for (int id : children) {
+            const QVariantMap properties = m_nodes.value(id).properties;
+            ActionForId::Iterator it = m_actionForId.find(id);
+            QAction *action = nullptr;
+            if (it == m_actionForId.end()) {
+                action = createAction(id, properties, menu);
+                m_actionForId.insert(id, action);
+
+                QObject::connect(action, &QObject::destroyed, q, [this, id, action]() {
+                    if (m_actionForId.value(id) == action) {
+                        m_actionForId.remove(id);
+                    }
+                });
+
+                QObject::connect(action, &QAction::triggered, q, [id, this]() {
+                    q->sendClickedEvent(id);
+                });
+
+                if (QMenu *menuAction = action->menu()) {
+                    QObject::connect(menuAction, &QMenu::aboutToShow, q, &DBusMenuImporter::slotMenuAboutToShow, Qt::UniqueConnection);
+                }
+
+                menu->addAction(action);
+            } else {
+                action = *it;
+                QStringList filteredKeys = properties.keys();
+                filteredKeys.removeOne("type");
+                filteredKeys.removeOne("toggle-type");
+                filteredKeys.removeOne("children-display");
+                updateAction(*it, properties, filteredKeys);
+                // Move the action to the tail so we can keep the order same as the dbus request.
+                menu->removeAction(action);
+                menu->addAction(action);
+            }
+        }
+    }
+
+    // Drops the actions of a closed submenu, its layout stays in m_nodes.
+    void releaseActions(QMenu *menu)
+    {
+        for (QAction *action : menu->actions()) {
+            if (QMenu *submenu = action->menu()) {
+                releaseActions(submenu);
+                submenu->deleteLater();
+            }
+            m_actionForId.remove(action->property(DBUSMENU_PROPERTY_ID).toInt());
+            menu->removeAction(action);
+            action->deleteLater();
+        }
+
+        m_populated.remove(menu->menuAction()->property(DBUSMENU_PROPERTY_ID).toInt());
+    }
+
     /**
      * Init all the immutable action properties here
      * TODO: Document immutable properties?
@@ -252,10 +374,11 @@ public:
         action->setShortcut(keySequence);
     }
 
+    // Does not create the root menu, layouts for it are only stored until it is.
     QMenu *menuForId(int id) const
     {
         if (id == 0) {
-            return q->menu();
+            return m_menu;
         }
         QAction *action = m_actionForId.value(id);
         if (!action) {
@@ -292,6 +415,7 @@ DBusMenuImporter::DBusMenuImporter(const QString &service, const QString &path,
             &DBusMenuInterface::ItemsPropertiesUpdated,
             this,
             [this](const DBusMenuItemList &updatedList, const DBusMenuItemKeysList &removedList) {
+                WakeupMonitor::dbusMessage(d->m_interface->service(), QStringLiteral("ItemsPropertiesUpdated"));
                 d->slotItemsPropertiesUpdated(updatedList, removedList);
             });
 
@@ -303,13 +427,16 @@ DBusMenuImporter::~DBusMenuImporter()
     // Do not use "delete d->m_menu": even if we are being deleted we should
     // leave enough time for the menu to finish what it was doing, for example
     // if it was being displayed.
-    d->m_menu->deleteLater();
+    if (d->m_menu) {
+        d->m_menu->deleteLater();
+    }
     delete d;
 }
 
 void DBusMenuImporter::slotLayoutUpdated(uint revision, int parentId)
 {
     Q_UNUSED(revision)
+    WakeupMonitor::dbusMessage(d->m_interface->service(), QStringLiteral("LayoutUpdated"));
     if (d->m_idsRefreshedByAboutToShow.remove(parentId)) {
         return;
     }
@@ -332,13 +459,28 @@ QMenu *DBusMenuImporter::menu() const
 {
     if (!d->m_menu) {
         d->m_menu = d->createMenu(nullptr);
+        // Fill it from the layout fetched so far.
+        d->populate(d->m_menu, 0);
     }
     return d->m_menu;
 }
 
+void DBusMenuImporter::populateMenu(QMenu *menu)
+{
+    Q_ASSERT(menu);
+    d->populate(menu, menu->menuAction()->property(DBUSMENU_PROPERTY_ID).toInt());
+}
+
 void DBusMenuImporterPrivate::slotItemsPropertiesUpdated(const DBusMenuItemList &updatedList, const DBusMenuItemKeysList &removedList)
 {
     Q_FOREACH (const DBusMenuItem &item, updatedList) {
+        QHash<int, Node>::Iterator node = m_nodes.find(item.id);
+        if (node != m_nodes.end()) {
+            for (auto it = item.properties.constBegin(); it != item.properties.constEnd(); ++it) {
+                node->properties.insert(it.key(), it.value());
+            }
+        }
+
         QAction *action = m_actionForId.value(item.id);
         if (!action) {
             // We don't know this action. It probably is in a menu we haven't fetched yet.
@@ -352,6 +494,13 @@ void DBusMenuImporterPrivate::slotItemsPropertiesUpdated(const DBusMenuItemList
     }
 
     Q_FOREACH (const DBusMenuItemKeys &item, removedList) {
+        QHash<int, Node>::Iterator node = m_nodes.find(item.id);
+        if (node != m_nodes.end()) {
+            for (const QString &key : item.properties) {
+                node->properties.remove(key);
+            }
+        }
+
         QAction *action = m_actionForId.value(item.id);
         if (!action) {
             // We don't know this action. It probably is in a menu we haven't fetched yet.
@@ -378,84 +527,30 @@ void DBusMenuImporter::slotItemActivationRequested(int id, uint /*timestamp*/)
 
 void DBusMenuImporter::slotGetLayoutFinished(QDBusPendingCallWatcher *watcher)
 {
+    WakeupMonitor::dbusMessage(d->m_interface->service(), QStringLiteral("GetLayout"));
     int parentId = watcher->property(DBUSMENU_PROPERTY_ID).toInt();
     watcher->deleteLater();
 
-    QMenu *menu = d->menuForId(parentId);
-
     QDBusPendingReply<uint, DBusMenuLayoutItem> reply = *watcher;
     if (!reply.isValid()) {
         qDebug() << reply.error().message();
-        if (menu) {
+        if (QMenu *menu = d->menuForId(parentId)) {
             emit menuUpdated(menu);
         }
         return;
     }
 
-#ifdef BENCHMARK
-    DMDEBUG << "- items received:" << sChrono.elapsed() << "ms";
-#endif
-    DBusMenuLayoutItem rootItem = reply.argumentAt<1>();
+    d->storeLayout(parentId, reply.argumentAt<1>());
 
+    QMenu *menu = d->menuForId(parentId);
     if (!menu) {
-        qDebug() << "No menu for id" << parentId;
+        // Not created yet, it is filled from the stored layout once it is.
         return;
     }
 
-    // remove outdated actions
-    QSet<int> newDBusMenuItemIds;
-    newDBusMenuItemIds.reserve(rootItem.children.count());
-    for (const DBusMenuLayoutItem &item : qAsConst(rootItem.children)) {
-        newDBusMenuItemIds << item.id;
-    }
-    for (QAction *action : menu->actions()) {
-        int id = action->property(DBUSMENU_PROPERTY_ID).toInt();
-        if (!newDBusMenuItemIds.contains(id)) {
-            // Not calling removeAction() as QMenu will immediately close when it becomes empty,
-            // which can happen when an application completely reloads this menu.
-            // When the action is deleted deferred, it is removed from the menu.
-            action->deleteLater();
-            if (action->menu()) {
-                action->menu()->deleteLater();
-            }
-            d->m_actionForId.remove(id);
-        }
-    }
-
-    // insert or update new actions into our menu
-    for (const DBusMenuLayoutItem &dbusMenuItem : qAsConst(rootItem.children)) {
-        DBusMenuImporterPrivate::ActionForId::Iterator it = d->m_actionForId.find(dbusMenuItem.id);
-        QAction *action = nullptr;
-        if (it == d->m_actionForId.end()) {
-            int id = dbusMenuItem.id;
-            action = d->createAction(id, dbusMenuItem.properties, menu);
-            d->m_actionForId.insert(id, action);
-
-            connect(action, &QObject::destroyed, this, [this, id]() {
-                d->m_actionForId.remove(id);
-            });
-
-            connect(action, &QAction::triggered, this, [id, this]() {
-                sendClickedEvent(id);
-            });
-
-            if (QMenu *menuAction = action->menu()) {
-                connect(menuAction, &QMenu::aboutToShow, this, &DBusMenuImporter::slotMenuAboutToShow, Qt::UniqueConnection);
-            }
-            connect(menu, &QMenu::aboutToHide, this, &DBusMenuImporter::slotMenuAboutToHide, Qt::UniqueConnection);
-
-            menu->addAction(action);
-        } else {
-            action = *it;
-            QStringList filteredKeys = dbusMenuItem.properties.keys();
-            filteredKeys.removeOne("type");
-            filteredKeys.removeOne("toggle-type");
-            filteredKeys.removeOne("children-display");
-            d->updateAction(*it, dbusMenuItem.properties, filteredKeys);
-            // Move the action to the tail so we can keep the order same as the dbus request.
-            menu->removeAction(action);
-            menu->addAction(action);
-        }
+    // Closed submenus keep just the data until they are shown.
+    if (d->m_populated.contains(parentId)) {
+        d->populate(menu, parentId);
     }
 
     emit menuUpdated(menu);
@@ -484,6 +579,7 @@ void DBusMenuImporter::updateMenu(QMenu *menu)
     QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(call, this);
     watcher->setProperty(DBUSMENU_PROPERTY_ID, id);
     connect(watcher, &QDBusPendingCallWatcher::finished, this, &DBusMenuImporter::slotAboutToShowDBusCallFinished);
+    Tracer::asyncCall(watcher, "DBusMenu AboutToShow", d->m_interface->service(), d->m_interface->path());
 
     // Firefox deliberately ignores "aboutToShow" whereas Qt ignores" opened", so we'll just send both all the time...
     d->sendEvent(id, QStringLiteral("opened"));
@@ -509,7 +605,7 @@ void DBusMenuImporter::slotAboutToShowDBusCallFinished(QDBusPendingCallWatcher *
     // this returns, which equates to the same thing
     bool needRefresh = reply.argumentAt<0>();
 
-    if (needRefresh || menu->actions().isEmpty()) {
+    if (needRefresh || !d->m_nodes.value(id).fetched) {
         d->m_idsRefreshedByAboutToShow << id;
         d->refresh(id);
     } else if (menu) {
@@ -527,6 +623,17 @@ void DBusMenuImporter::slotMenuAboutToHide()
 
     int id = action->property(DBUSMENU_PROPERTY_ID).toInt();
     d->sendEvent(id, QStringLiteral("closed"));
+
+    // Submenus only keep their actions while open. Released from the event
+    // loop since a triggered action is activated after its menu hid.
+    if (menu != d->m_menu) {
+        QPointer<QMenu> guard(menu);
+        QTimer::singleShot(0, this, [this, guard]() {
+            if (guard && !guard->isVisible()) {
+                d->releaseActions(guard);
+            }
+        });
+    }
 }
 
 void DBusMenuImporter::slotMenuAboutToShow()
@@ -534,6 +641,8 @@ void DBusMenuImporter::slotMenuAboutToShow()
     QMenu *menu = qobject_cast<QMenu *>(sender());
     Q_ASSERT(menu);
 
+    // Show what was fetched before right away, AboutToShow refreshes it.
+    populateMenu(menu);
     updateMenu(menu);
 }
 
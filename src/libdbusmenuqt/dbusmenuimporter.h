@@ -53,6 +53,12 @@ public:
      */
     QMenu *menu() const;
 
+    /**
+     * Fills a submenu from the layout fetched so far, without asking the
+     * exporter. Submenus are otherwise only populated on aboutToShow.
+     */
+    void populateMenu(QMenu *menu);
+
 public Q_SLOTS:
     /**
      * Load the menu
@@ -103,6 +109,7 @@ private:
     Q_DISABLE_COPY(DBusMenuImporter)
     DBusMenuImporterPrivate *const d;
     friend class DBusMenuImporterPrivate;
+    friend class StatusBarBenchmark;
 
     // Use Q_PRIVATE_SLOT to avoid exposing DBusMenuItemList
     Q_PRIVATE_SLOT(d, void slotItemsPropertiesUpdated(const DBusMenuItemList &updatedList, const DBusMenuItemKeysList &removedList))
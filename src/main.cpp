@@ -23,24 +23,26 @@
 #include <QIcon>
 #include <QDir>
 #include <QDebug>
+#include <QFile>
+#include <QDBusConnection>
 
 #include "statusbar.h"
-#include "controlcenterdialog.h"
-#include "systemtray/systemtraymodel.h"
-#include "appmenu/appmenumodel.h"
-#include "appmenu/appmenuapplet.h"
-#include "poweractions.h"
-#include "notifications.h"
-#include "backgroundhelper.h"
-
-#include "appearance.h"
-#include "brightness.h"
-#include "battery.h"
+#include "startupprofiler.h"
+#include "wakeupmonitor.h"
+#include "stallwatchdog.h"
+#include "tracer.h"
+#include "dbusrecorder.h"
 
 int main(int argc, char *argv[])
 {
     QCoreApplication::setAttribute(Qt::AA_EnableHighDpiScaling);
+    StartupProfiler::start();
     QApplication app(argc, argv);
+    Tracer::init();
+    DBusRecorder::start();
+    StartupProfiler::mark("application");
+    WakeupMonitor::self();
+    StallWatchdog::self();
 
     // Set icon theme for Qt6
     // In Qt6, we need to ensure icon theme is properly set
@@ -72,17 +74,8 @@ int main(int argc, char *argv[])
         qWarning() << "StatusBar: No icon theme set! image://icontheme/ URLs will not work.";
     }
 
-    const char *uri = "Cutefish.StatusBar";
-    qmlRegisterType<SystemTrayModel>(uri, 1, 0, "SystemTrayModel");
-    qmlRegisterType<ControlCenterDialog>(uri, 1, 0, "ControlCenterDialog");
-    qmlRegisterType<Appearance>(uri, 1, 0, "Appearance");
-    qmlRegisterType<Brightness>(uri, 1, 0, "Brightness");
-    qmlRegisterType<Battery>(uri, 1, 0, "Battery");
-    qmlRegisterType<AppMenuModel>(uri, 1, 0, "AppMenuModel");
-    qmlRegisterType<AppMenuApplet>(uri, 1, 0, "AppMenuApplet");
-    qmlRegisterType<PowerActions>(uri, 1, 0, "PowerActions");
-    qmlRegisterType<Notifications>(uri, 1, 0, "Notifications");
-    qmlRegisterType<BackgroundHelper>(uri, 1, 0, "BackgroundHelper");
+    // QML types are registered by the Cutefish.StatusBar module, see QML_ELEMENT.
+    StartupProfiler::mark("icon theme");
 
     QString qmFilePath = QString("%1/%2.qm").arg("/usr/share/cutefish-statusbar/translations/").arg(QLocale::system().name());
     if (QFile::exists(qmFilePath)) {
@@ -94,6 +87,8 @@ int main(int argc, char *argv[])
         }
     }
 
+    StartupProfiler::mark("translations");
+
     StatusBar bar;
 
     if (!QDBusConnection::sessionBus().registerService("com.cutefish.Statusbar")) {
@@ -104,5 +99,12 @@ int main(int argc, char *argv[])
         return -1;
     }
 
+    // Test hooks for benchmarks/run-e2e.sh, not part of the public interface.
+    if (qEnvironmentVariableIsSet("CUTEFISH_STATUSBAR_HARNESS")) {
+        QDBusConnection::sessionBus().registerObject("/Harness", &bar, QDBusConnection::ExportScriptableSlots);
+    }
+
+    StartupProfiler::mark("dbus service");
+
     return app.exec();
 }
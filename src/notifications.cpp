@@ -19,18 +19,32 @@
 
 #include "notifications.h"
 
+static Notifications *SELF = nullptr;
+
+Notifications *Notifications::self()
+{
+    if (!SELF)
+        SELF = new Notifications;
+
+    return SELF;
+}
+
+Notifications *Notifications::create(QQmlEngine *, QJSEngine *)
+{
+    // Shared with the C++ side, the engine must not take ownership.
+    QJSEngine::setObjectOwnership(self(), QJSEngine::CppOwnership);
+    return self();
+}
+
 Notifications::Notifications(QObject *parent)
     : QObject(parent)
-    , m_iface("com.cutefish.Notification",
-              "/Notification",
-              "com.cutefish.Notification", QDBusConnection::sessionBus())
+    , m_properties("com.cutefish.Notification",
+                   "/Notification",
+                   "com.cutefish.Notification", QDBusConnection::sessionBus())
+    , m_doNotDisturb(false)
 {
-    m_doNotDisturb = m_iface.property("doNotDisturb").toBool();
-
-    QDBusConnection::sessionBus().connect("com.cutefish.Notification",
-                                          "/Notification",
-                                          "com.cutefish.Notification",
-                                          "doNotDisturbChanged", this, SLOT(onDBusDoNotDisturbChanged()));
+    m_properties.watchSignal("doNotDisturbChanged", "doNotDisturb");
+    connect(&m_properties, &DBusPropertyCache::propertyChanged, this, &Notifications::onPropertyChanged);
 }
 
 bool Notifications::doNotDisturb() const
@@ -41,20 +55,17 @@ bool Notifications::doNotDisturb() const
 void Notifications::setDoNotDisturb(bool enabled)
 {
     m_doNotDisturb = enabled;
-
-    QDBusInterface iface("com.cutefish.Notification",
-                         "/Notification",
-                         "com.cutefish.Notification", QDBusConnection::sessionBus());
-
-    if (iface.isValid()) {
-        iface.asyncCall("setDoNotDisturb", enabled);
-    }
+    m_properties.setCachedValue("doNotDisturb", enabled);
+    m_properties.asyncCall("setDoNotDisturb", { enabled });
 
     emit doNotDisturbChanged();
 }
 
-void Notifications::onDBusDoNotDisturbChanged()
+void Notifications::onPropertyChanged(const QString &name, const QVariant &value)
 {
-    m_doNotDisturb = m_iface.property("doNotDisturb").toBool();
+    if (name != "doNotDisturb" || m_doNotDisturb == value.toBool())
+        return;
+
+    m_doNotDisturb = value.toBool();
     emit doNotDisturbChanged();
 }
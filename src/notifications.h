@@ -21,28 +21,33 @@
 #define NOTIFICATIONS_H
 
 #include <QObject>
-#include <QDBusInterface>
-#include <QDBusPendingCall>
+#include <QQmlEngine>
+#include "dbuspropertycache.h"
 
 class Notifications : public QObject
 {
     Q_OBJECT
+    QML_ELEMENT
+    QML_SINGLETON
     Q_PROPERTY(bool doNotDisturb READ doNotDisturb WRITE setDoNotDisturb NOTIFY doNotDisturbChanged)
 
 public:
+    static Notifications *self();
+    static Notifications *create(QQmlEngine *, QJSEngine *);
+
     explicit Notifications(QObject *parent = nullptr);
 
     bool doNotDisturb() const;
     void setDoNotDisturb(bool enabled);
 
 private slots:
-    void onDBusDoNotDisturbChanged();
+    void onPropertyChanged(const QString &name, const QVariant &value);
 
 signals:
     void doNotDisturbChanged();
 
 private:
-    QDBusInterface m_iface;
+    DBusPropertyCache m_properties;
     bool m_doNotDisturb;
 };
 
@@ -18,6 +18,7 @@
  */
 
 #include "poweractions.h"
+#include "stallwatchdog.h"
 #include <QCommandLineParser>
 #include <QDBusInterface>
 #include <QApplication>
@@ -27,6 +28,23 @@ const static QString s_dbusName = "com.cutefish.Session";
 const static QString s_pathName = "/Session";
 const static QString s_interfaceName = "com.cutefish.Session";
 
+static PowerActions *SELF = nullptr;
+
+PowerActions *PowerActions::self()
+{
+    if (!SELF)
+        SELF = new PowerActions;
+
+    return SELF;
+}
+
+PowerActions *PowerActions::create(QQmlEngine *, QJSEngine *)
+{
+    // Shared with the C++ side, the engine must not take ownership.
+    QJSEngine::setObjectOwnership(self(), QJSEngine::CppOwnership);
+    return self();
+}
+
 PowerActions::PowerActions(QObject *parent)
     : QObject(parent)
 {
@@ -35,6 +53,7 @@ PowerActions::PowerActions(QObject *parent)
 
 void PowerActions::shutdown()
 {
+    BlockingSection section("dbus", s_dbusName + " powerOff");
     QDBusInterface iface(s_dbusName, s_pathName, s_interfaceName, QDBusConnection::sessionBus());
     if (iface.isValid()) {
         iface.call("powerOff");
@@ -43,6 +62,7 @@ void PowerActions::shutdown()
 
 void PowerActions::logout()
 {
+    BlockingSection section("dbus", s_dbusName + " logout");
     QDBusInterface iface(s_dbusName, s_pathName, s_interfaceName, QDBusConnection::sessionBus());
     if (iface.isValid()) {
         iface.call("logout");
@@ -51,6 +71,7 @@ void PowerActions::logout()
 
 void PowerActions::reboot()
 {
+    BlockingSection section("dbus", s_dbusName + " reboot");
     QDBusInterface iface(s_dbusName, s_pathName, s_interfaceName, QDBusConnection::sessionBus());
     if (iface.isValid()) {
         iface.call("reboot");
@@ -64,6 +85,7 @@ void PowerActions::lockScreen()
 
 void PowerActions::suspend()
 {
+    BlockingSection section("dbus", s_dbusName + " suspend");
     QDBusInterface iface(s_dbusName, s_pathName, s_interfaceName, QDBusConnection::sessionBus());
 
     if (iface.isValid()) {
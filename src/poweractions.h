@@ -21,12 +21,18 @@
 #define ACTIONS_H
 
 #include <QObject>
+#include <QQmlEngine>
 
 class PowerActions : public QObject
 {
     Q_OBJECT
+    QML_ELEMENT
+    QML_SINGLETON
 
 public:
+    static PowerActions *self();
+    static PowerActions *create(QQmlEngine *, QJSEngine *);
+
     explicit PowerActions(QObject *parent = nullptr);
 
     Q_INVOKABLE void shutdown();
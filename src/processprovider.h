@@ -21,10 +21,13 @@
 #define PROCESSPROVIDER_H
 
 #include <QObject>
+#include <QQmlEngine>
 
 class ProcessProvider : public QObject
 {
     Q_OBJECT
+    QML_ELEMENT
+    QML_SINGLETON
 
 public:
     explicit ProcessProvider(QObject *parent = nullptr);
@@ -0,0 +1,247 @@
+/*
+ * Copyright (C) 2021 CutefishOS Team.
+ *
+ * Author:     cutefishos <cutefishos@foxmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "stallwatchdog.h"
+
+#include <QAbstractEventDispatcher>
+#include <QCoreApplication>
+#include <QThread>
+#include <QDebug>
+
+#include <algorithm>
+#include <utility>
+
+// Upper bounds of the histogram buckets in ms, the last one is open.
+static const qint64 s_bucketLimits[] = { 16, 32, 64, 128, 256, 512, 1024, 2048 };
+static const int s_bucketCount = sizeof(s_bucketLimits) / sizeof(s_bucketLimits[0]) + 1;
+
+static StallWatchdog *SELF = nullptr;
+
+static QString bucketName(int bucket)
+{
+    const qint64 lower = bucket > 0 ? s_bucketLimits[bucket - 1] : 0;
+
+    if (bucket == s_bucketCount - 1)
+        return QString(">%1 ms").arg(lower);
+
+    return QString("%1-%2 ms").arg(lower).arg(s_bucketLimits[bucket]);
+}
+
+StallWatchdog *StallWatchdog::self()
+{
+    if (!SELF)
+        SELF = new StallWatchdog;
+
+    return SELF;
+}
+
+StallWatchdog::StallWatchdog(QObject *parent)
+    : QObject(parent)
+    , m_threshold(0)
+    , m_thread(nullptr)
+    , m_quit(false)
+    , m_busy(false)
+    , m_slice(0)
+    , m_reportedSlice(0)
+    , m_busySince(0)
+    , m_sliceSectionTime(0)
+    , m_buckets(s_bucketCount, 0)
+{
+    // Off unless CUTEFISH_STATUSBAR_STALL_MS sets a threshold, watching
+    // wakes a second thread on every event loop iteration.
+    bool ok = false;
+    const int threshold = qEnvironmentVariableIntValue("CUTEFISH_STATUSBAR_STALL_MS", &ok);
+    if (ok)
+        m_threshold = threshold;
+
+    m_clock.start();
+
+    if (m_threshold <= 0)
+        return;
+
+    if (QAbstractEventDispatcher *dispatcher = QAbstractEventDispatcher::instance()) {
+        connect(dispatcher, &QAbstractEventDispatcher::awake, this, &StallWatchdog::onAwake, Qt::DirectConnection);
+        connect(dispatcher, &QAbstractEventDispatcher::aboutToBlock, this, &StallWatchdog::onAboutToBlock, Qt::DirectConnection);
+    }
+
+    m_thread = QThread::create([this] { watch(); });
+    m_thread->setObjectName(QStringLiteral("StallWatchdog"));
+    m_thread->start(QThread::LowPriority);
+}
+
+StallWatchdog::~StallWatchdog()
+{
+    if (m_thread) {
+        {
+            QMutexLocker locker(&m_mutex);
+            m_quit = true;
+            m_condition.wakeOne();
+        }
+        m_thread->wait();
+        delete m_thread;
+    }
+
+    if (SELF == this)
+        SELF = nullptr;
+}
+
+int StallWatchdog::threshold() const
+{
+    return m_threshold;
+}
+
+QVariantMap StallWatchdog::histogram() const
+{
+    QVariantMap result;
+
+    for (int i = 0; i < s_bucketCount; ++i)
+        result.insert(bucketName(i), m_buckets.at(i));
+
+    return result;
+}
+
+QString StallWatchdog::report() const
+{
+    if (m_threshold <= 0)
+        return QStringLiteral("Stall watchdog is off, set CUTEFISH_STATUSBAR_STALL_MS to a threshold in ms.");
+
+    QStringList lines;
+    lines << QString("Stalls over %1 ms:").arg(m_threshold);
+
+    for (int i = 0; i < s_bucketCount; ++i) {
+        if (m_buckets.at(i))
+            lines << QString("  %1 %2").arg(bucketName(i), -14).arg(m_buckets.at(i));
+    }
+
+    QList<QString> names = m_sections.keys();
+    std::sort(names.begin(), names.end(), [this] (const QString &a, const QString &b) {
+        return m_sections.value(a).total > m_sections.value(b).total;
+    });
+
+    lines << QStringLiteral("By blocking section:");
+    for (const QString &name : std::as_const(names)) {
+        const Section &section = m_sections[name];
+        lines << QString("  %1 stalls, %2 ms total, %3 ms longest  %4")
+                 .arg(section.stalls, 5).arg(section.total, 7).arg(section.longest, 6).arg(name);
+    }
+
+    return lines.join(QLatin1Char('\n'));
+}
+
+void StallWatchdog::onAwake()
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (m_busy)
+        return;
+
+    m_busy = true;
+    ++m_slice;
+    m_busySince = m_clock.elapsed();
+    m_sliceSection.clear();
+    m_sliceSectionTime = 0;
+    m_condition.wakeOne();
+}
+
+void StallWatchdog::onAboutToBlock()
+{
+    qint64 duration;
+
+    {
+        QMutexLocker locker(&m_mutex);
+
+        if (!m_busy)
+            return;
+
+        m_busy = false;
+        duration = m_clock.elapsed() - m_busySince;
+    }
+
+    if (duration >= m_threshold)
+        record(duration, m_sliceSection.isEmpty() ? QStringLiteral("unattributed") : m_sliceSection);
+}
+
+void StallWatchdog::watch()
+{
+    QMutexLocker locker(&m_mutex);
+
+    while (!m_quit) {
+        if (!m_busy || m_reportedSlice == m_slice) {
+            m_condition.wait(&m_mutex);
+            continue;
+        }
+
+        const qint64 remaining = m_busySince + m_threshold - m_clock.elapsed();
+        if (remaining > 0) {
+            m_condition.wait(&m_mutex, remaining);
+            continue;
+        }
+
+        // Still inside the same slice, report it once while it is happening.
+        m_reportedSlice = m_slice;
+        qWarning().noquote() << QString("StatusBar: GUI thread stalled for %1 ms in %2")
+                                .arg(m_clock.elapsed() - m_busySince)
+                                .arg(m_section.isEmpty() ? QStringLiteral("unknown code") : m_section);
+    }
+}
+
+void StallWatchdog::record(qint64 duration, const QString &section)
+{
+    const qint64 *limit = std::lower_bound(std::begin(s_bucketLimits), std::end(s_bucketLimits), duration);
+    ++m_buckets[limit - std::begin(s_bucketLimits)];
+
+    Section &stats = m_sections[section];
+    ++stats.stalls;
+    stats.total += duration;
+    stats.longest = qMax(stats.longest, duration);
+
+    qWarning().noquote() << QString("StatusBar: GUI thread stall of %1 ms, longest blocking section %2")
+                            .arg(duration).arg(section);
+}
+
+BlockingSection::BlockingSection(const char *kind, const QString &what)
+    : m_active(SELF && SELF->m_thread && QThread::currentThread() == SELF->thread())
+{
+    if (!m_active)
+        return;
+
+    m_name = QString::fromLatin1(kind) + QLatin1Char(':') + what;
+    m_timer.start();
+
+    QMutexLocker locker(&SELF->m_mutex);
+    m_previous = SELF->m_section;
+    SELF->m_section = m_name;
+}
+
+BlockingSection::~BlockingSection()
+{
+    if (!m_active || !SELF)
+        return;
+
+    const qint64 elapsed = m_timer.elapsed();
+
+    // The longest section of the slice gets the blame.
+    if (elapsed > SELF->m_sliceSectionTime) {
+        SELF->m_sliceSection = m_name;
+        SELF->m_sliceSectionTime = elapsed;
+    }
+
+    QMutexLocker locker(&SELF->m_mutex);
+    SELF->m_section = m_previous;
+}
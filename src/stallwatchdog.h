@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2021 CutefishOS Team.
+ *
+ * Author:     cutefishos <cutefishos@foxmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef STALLWATCHDOG_H
+#define STALLWATCHDOG_H
+
+#include <QObject>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QElapsedTimer>
+#include <QVariantMap>
+#include <QVector>
+#include <QHash>
+
+class QThread;
+
+/**
+ * Detects GUI thread stalls longer than a threshold.
+ *
+ * A watchdog thread is woken whenever the event loop starts working and
+ * reports a stall while it is still going on. When the loop goes back to
+ * sleep the stall is added to a histogram and attributed to the longest
+ * BlockingSection that ran during it.
+ *
+ * Only runs when CUTEFISH_STATUSBAR_STALL_MS gives a threshold in ms.
+ */
+class StallWatchdog : public QObject
+{
+    Q_OBJECT
+
+public:
+    static StallWatchdog *self();
+    explicit StallWatchdog(QObject *parent = nullptr);
+    ~StallWatchdog();
+
+    int threshold() const;
+
+    QVariantMap histogram() const;
+    QString report() const;
+
+private slots:
+    void onAwake();
+    void onAboutToBlock();
+
+private:
+    friend class BlockingSection;
+
+    struct Section {
+        quint32 stalls = 0;
+        qint64 total = 0;
+        qint64 longest = 0;
+    };
+
+    void watch();
+    void record(qint64 duration, const QString &section);
+
+private:
+    int m_threshold;
+    QThread *m_thread;
+    QElapsedTimer m_clock;
+
+    // Shared with the watchdog thread.
+    mutable QMutex m_mutex;
+    QWaitCondition m_condition;
+    bool m_quit;
+    bool m_busy;
+    quint64 m_slice;
+    quint64 m_reportedSlice;
+    qint64 m_busySince;
+    QString m_section;
+
+    // GUI thread only.
+    QString m_sliceSection;
+    qint64 m_sliceSectionTime;
+    QVector<quint32> m_buckets;
+    QHash<QString, Section> m_sections;
+};
+
+/**
+ * Marks a call that blocks the GUI thread, e.g.
+ *
+ *     BlockingSection section("dbus", service + " " + member);
+ *
+ * Stalls that happen while it is alive are attributed to it.
+ */
+class BlockingSection
+{
+public:
+    BlockingSection(const char *kind, const QString &what);
+    ~BlockingSection();
+
+private:
+    Q_DISABLE_COPY(BlockingSection)
+
+    bool m_active;
+    QString m_name;
+    QString m_previous;
+    QElapsedTimer m_timer;
+};
+
+#endif // STALLWATCHDOG_H
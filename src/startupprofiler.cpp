@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2021 CutefishOS Team.
+ *
+ * Author:     cutefishos <cutefishos@foxmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "startupprofiler.h"
+
+#include <QQuickWindow>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTimer>
+#include <QList>
+#include <QPair>
+#include <QDebug>
+
+#include <utility>
+
+// Backends answering later than this after the first frame are not startup anymore.
+static const int s_settleTime = 3000;
+
+static QElapsedTimer s_clock;
+static QList<QPair<QString, qint64>> s_stages;
+static bool s_finished = false;
+
+static void printBreakdown()
+{
+    s_finished = true;
+
+    qint64 previous = 0;
+    qInfo() << "StatusBar: startup breakdown";
+    for (const auto &stage : std::as_const(s_stages)) {
+        qInfo().noquote() << QString("  %1 +%2 ms (%3 ms)")
+                             .arg(stage.first, -32)
+                             .arg(stage.second - previous)
+                             .arg(stage.second);
+        previous = stage.second;
+    }
+    qInfo().noquote() << QString("  resident memory %1 KiB").arg(StartupProfiler::residentMemory());
+
+    s_stages.clear();
+}
+
+void StartupProfiler::start()
+{
+    if (!qEnvironmentVariableIsSet("CUTEFISH_STATUSBAR_STARTUP_PROFILE"))
+        return;
+
+    s_clock.start();
+    s_stages.clear();
+    s_finished = false;
+}
+
+void StartupProfiler::mark(const QString &stage)
+{
+    if (s_finished || !s_clock.isValid())
+        return;
+
+    s_stages.append(qMakePair(stage, s_clock.elapsed()));
+}
+
+void StartupProfiler::watchFirstFrame(QQuickWindow *window)
+{
+    if (!s_clock.isValid())
+        return;
+
+    // frameSwapped comes from the render thread, queue it back to us.
+    QObject::connect(window, &QQuickWindow::frameSwapped, window, [] {
+        mark(QStringLiteral("first frame"));
+        QTimer::singleShot(s_settleTime, [] { printBreakdown(); });
+    }, static_cast<Qt::ConnectionType>(Qt::QueuedConnection | Qt::SingleShotConnection));
+}
+
+void StartupProfiler::report(const QString &component)
+{
+    if (!s_clock.isValid())
+        return;
+
+    qInfo().noquote() << QString("StatusBar: %1 created at %2 ms, resident memory %3 KiB")
+                         .arg(component)
+                         .arg(s_clock.elapsed())
+                         .arg(residentMemory());
+}
+
+qint64 StartupProfiler::residentMemory()
+{
+    QFile file(QStringLiteral("/proc/self/status"));
+
+    if (!file.open(QIODevice::ReadOnly))
+        return -1;
+
+    while (!file.atEnd()) {
+        const QByteArray line = file.readLine();
+
+        if (line.startsWith("VmRSS:"))
+            return line.mid(6).trimmed().split(' ').first().toLongLong();
+    }
+
+    return -1;
+}
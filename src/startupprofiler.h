@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2021 CutefishOS Team.
+ *
+ * Author:     cutefishos <cutefishos@foxmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef STARTUPPROFILER_H
+#define STARTUPPROFILER_H
+
+#include <QString>
+
+class QQuickWindow;
+
+/**
+ * Records how long each startup stage took and prints the breakdown
+ * once the first frame is on screen and the backends have answered.
+ * Only active when CUTEFISH_STATUSBAR_STARTUP_PROFILE is set.
+ */
+class StartupProfiler
+{
+public:
+    static void start();
+    static void mark(const QString &stage);
+    static void watchFirstFrame(QQuickWindow *window);
+
+    // Logs a component created on demand, with the time since start and RSS.
+    static void report(const QString &component);
+
+    static qint64 residentMemory();
+};
+
+#endif // STARTUPPROFILER_H
@@ -19,28 +19,62 @@
 
 #include "statusbar.h"
 #include "battery.h"
-#include "processprovider.h"
+#include "clock.h"
+#include "ecomode.h"
 #include "appmenu/appmenu.h"
 #include "statusbaradaptor.h"
+#include "startupprofiler.h"
+#include "wakeupmonitor.h"
+#include "stallwatchdog.h"
+#include "tracer.h"
+#include "framestatistics.h"
+#include "systemtray/trayiconprovider.h"
 
 #include <QQmlEngine>
-#include <QQmlContext>
 
 #include <QDBusConnection>
+#include <QDBusError>
 #include <QApplication>
 #include <QSettings>
 #include <QScreen>
+#include <QTimer>
 
 #include <NETWM>
 #include <KWindowEffects>
 #include <KX11Extras>     // KF6 迁移关键头文件
 
+static StatusBar *SELF = nullptr;
+
+// Longer than SystemTrayModel's own timeout, so that one normally answers.
+static const int s_trayMenuTimeout = 6000;
+
+StatusBar *StatusBar::self()
+{
+    return SELF;
+}
+
+StatusBar *StatusBar::create(QQmlEngine *, QJSEngine *)
+{
+    // The window is created by main() before any QML is loaded.
+    QJSEngine::setObjectOwnership(SELF, QJSEngine::CppOwnership);
+    return SELF;
+}
+
 StatusBar::StatusBar(QQuickView *parent)
     : QQuickView(parent)
-    , m_acticity(new Activity)
+    , m_acticity(Activity::self())
+    , m_trayMenuSerial(0)
 {
+    SELF = this;
+
     QSettings settings("cutefishos", "locale");
     m_twentyFourTime = settings.value("twentyFour", false).toBool();
+    Clock::self()->setTwentyFourTime(m_twentyFourTime);
+
+    // Milliseconds after the first frame to create the popups ahead of use,
+    // a negative value creates them on first open only.
+    QSettings statusbarSettings("cutefishos", "statusbar");
+    m_prewarmDelay = statusbarSettings.value("PrewarmDelay", -1).toInt();
 
     setFlags(Qt::FramelessWindowHint | Qt::WindowDoesNotAcceptFocus);
     setColor(Qt::transparent);
@@ -52,21 +86,35 @@ StatusBar::StatusBar(QQuickView *parent)
 #endif
 
     new StatusbarAdaptor(this);
-    new AppMenu(this);
+    StartupProfiler::mark("window");
+
+    // Backends are QML singletons now, they start with placeholder values
+    // and fill in as their replies arrive.
+    engine()->addImageProvider(QStringLiteral("trayicon"), new TrayIconProvider);
+    StartupProfiler::mark("backends");
 
-    engine()->rootContext()->setContextProperty("StatusBar", this);
-    engine()->rootContext()->setContextProperty("acticity", m_acticity);
-    engine()->rootContext()->setContextProperty("process", new ProcessProvider);
-    engine()->rootContext()->setContextProperty("battery", Battery::self());
+    // Compiled ahead of time into the Cutefish.StatusBar module.
+    setSource(QUrl(QStringLiteral("qrc:/qt/qml/Cutefish/StatusBar/main.qml")));
+    StartupProfiler::mark("qml");
 
-    setSource(QUrl(QStringLiteral("qrc:/qml/main.qml")));
     setResizeMode(QQuickView::SizeRootObjectToView);
     setScreen(qApp->primaryScreen());
     updateGeometry();
+    StartupProfiler::watchFirstFrame(this);
+    Tracer::watchWindow(this);
+    FrameStatistics::self()->watch(this);
     setVisible(true);
     initState();
+    StartupProfiler::mark("shown");
+
+    // The global menu is not needed for the first frame.
+    connect(this, &QQuickWindow::frameSwapped, this, &StatusBar::initDeferred,
+            static_cast<Qt::ConnectionType>(Qt::QueuedConnection | Qt::SingleShotConnection));
 
     connect(m_acticity, &Activity::launchPadChanged, this, &StatusBar::initState);
+    connect(EcoMode::self(), &EcoMode::enabledChanged, this, [=] {
+        KWindowEffects::enableBlurBehind(this, EcoMode::self()->blurEnabled());
+    });
 
     connect(screen(), &QScreen::virtualGeometryChanged, this, &StatusBar::updateGeometry);
     connect(screen(), &QScreen::geometryChanged, this, &StatusBar::updateGeometry);
@@ -85,6 +133,16 @@ bool StatusBar::twentyFourTime()
     return m_twentyFourTime;
 }
 
+int StatusBar::prewarmDelay() const
+{
+    return m_prewarmDelay;
+}
+
+void StatusBar::componentLoaded(const QString &name)
+{
+    StartupProfiler::report(name);
+}
+
 void StatusBar::setBatteryPercentage(bool enabled)
 {
     Battery::self()->setShowPercentage(enabled);
@@ -94,10 +152,100 @@ void StatusBar::setTwentyFourTime(bool t)
 {
     if (m_twentyFourTime != t) {
         m_twentyFourTime = t;
+        Clock::self()->setTwentyFourTime(t);
         emit twentyFourTimeChanged();
     }
 }
 
+void StatusBar::setEcoMode(const QString &mode)
+{
+    if (mode == "on")
+        EcoMode::self()->setPolicy(EcoMode::On);
+    else if (mode == "off")
+        EcoMode::self()->setPolicy(EcoMode::Off);
+    else
+        EcoMode::self()->setPolicy(EcoMode::Auto);
+}
+
+bool StatusBar::ecoMode()
+{
+    return EcoMode::self()->enabled();
+}
+
+void StatusBar::setWakeupMonitor(bool enabled)
+{
+    WakeupMonitor::self()->setEnabled(enabled);
+}
+
+QVariantMap StatusBar::wakeupCounts(int minutes)
+{
+    return WakeupMonitor::self()->counts(minutes);
+}
+
+QString StatusBar::wakeupReport(int minutes)
+{
+    return WakeupMonitor::self()->report(minutes);
+}
+
+QVariantMap StatusBar::stallHistogram()
+{
+    return StallWatchdog::self()->histogram();
+}
+
+QString StatusBar::stallReport()
+{
+    const QString report = StallWatchdog::self()->report();
+    qInfo().noquote() << report;
+    return report;
+}
+
+QVariantMap StatusBar::frameStatistics()
+{
+    return FrameStatistics::self()->statistics();
+}
+
+void StatusBar::setFrameOverlay(bool enabled)
+{
+    FrameStatistics::self()->setOverlayEnabled(enabled);
+}
+
+int StatusBar::openTrayMenu(const QString &id)
+{
+    if (calledFromDBus()) {
+        if (m_pendingTrayMenus.contains(id)) {
+            sendErrorReply(QDBusError::LimitsExceeded, QStringLiteral("A menu of %1 is already being opened").arg(id));
+            return -1;
+        }
+
+        setDelayedReply(true);
+
+        PendingTrayMenu pending;
+        pending.message = message();
+        pending.timer.start();
+        pending.serial = ++m_trayMenuSerial;
+        m_pendingTrayMenus.insert(id, pending);
+
+        // Also answers when nothing handles the request.
+        QTimer::singleShot(s_trayMenuTimeout, this, [=] {
+            if (m_pendingTrayMenus.value(id).serial == pending.serial)
+                trayMenuOpened(id, false);
+        });
+    }
+
+    emit trayMenuRequested(id);
+    return -1;
+}
+
+void StatusBar::trayMenuOpened(const QString &id, bool ok)
+{
+    if (!m_pendingTrayMenus.contains(id))
+        return;
+
+    const PendingTrayMenu pending = m_pendingTrayMenus.take(id);
+    const int elapsed = ok ? int(pending.timer.elapsed()) : -1;
+    QDBusConnection::sessionBus().send(pending.message.createReply(elapsed));
+}
+
 void StatusBar::updateGeometry()
 {
     const QRect rect = screen()->geometry();
@@ -112,7 +260,7 @@ void StatusBar::updateGeometry()
     updateViewStruts();
 
     // KF6: enableBlurBehind() 需要 QWindow*
-    KWindowEffects::enableBlurBehind(this, true);
+    KWindowEffects::enableBlurBehind(this, EcoMode::self()->blurEnabled());
 }
 
 void StatusBar::updateViewStruts()
@@ -152,6 +300,15 @@ void StatusBar::initState()
 #endif
 }
 
+void StatusBar::initDeferred()
+{
+    new AppMenu(this);
+    StartupProfiler::mark("appmenu");
+
+    if (m_prewarmDelay >= 0 && !EcoMode::self()->enabled())
+        QTimer::singleShot(m_prewarmDelay, this, &StatusBar::prewarmRequested);
+}
+
 void StatusBar::onPrimaryScreenChanged(QScreen *screen)
 {
     disconnect(this->screen());
@@ -21,39 +21,87 @@
 #define STATUSBAR_H
 
 #include <QQuickView>
+#include <QQmlEngine>
+#include <QDBusContext>
+#include <QDBusMessage>
+#include <QElapsedTimer>
 #include "activity.h"
 
-class StatusBar : public QQuickView
+class StatusBar : public QQuickView, protected QDBusContext
 {
     Q_OBJECT
+    // Scriptable slots, only exported on /Harness, see main.cpp.
+    Q_CLASSINFO("D-Bus Interface", "com.cutefish.Statusbar.Harness")
+    QML_ELEMENT
+    QML_SINGLETON
     Q_PROPERTY(QRect screenRect READ screenRect NOTIFY screenRectChanged)
     Q_PROPERTY(bool twentyFourTime READ twentyFourTime NOTIFY twentyFourTimeChanged)
+    Q_PROPERTY(int prewarmDelay READ prewarmDelay CONSTANT)
 
 public:
+    static StatusBar *self();
+    static StatusBar *create(QQmlEngine *, QJSEngine *);
+
     explicit StatusBar(QQuickView *parent = nullptr);
 
     QRect screenRect();
     bool twentyFourTime();
+    int prewarmDelay() const;
+
+    Q_INVOKABLE void componentLoaded(const QString &name);
+    Q_INVOKABLE void trayMenuOpened(const QString &id, bool ok);
 
     void setBatteryPercentage(bool enabled);
     void setTwentyFourTime(bool t);
 
+    // "auto", "on" or "off"
+    void setEcoMode(const QString &mode);
+    bool ecoMode();
+
+    void setWakeupMonitor(bool enabled);
+    QVariantMap wakeupCounts(int minutes);
+    QString wakeupReport(int minutes);
+
+    QVariantMap stallHistogram();
+    QString stallReport();
+
+    // "sources" stays empty unless setWakeupMonitor or the overlay is on.
+    QVariantMap frameStatistics();
+    void setFrameOverlay(bool enabled);
+
     void updateGeometry();
     void updateViewStruts();
 
+public slots:
+    // For the end-to-end harness. Pops up the menu of a tray item, the reply
+    // carries the milliseconds until its layout was applied or -1.
+    Q_SCRIPTABLE int openTrayMenu(const QString &id);
+
 signals:
     void screenRectChanged();
     void launchPadChanged();
     void twentyFourTimeChanged();
+    void prewarmRequested();
+    void trayMenuRequested(const QString &id);
 
 private slots:
     void initState();
+    void initDeferred();
     void onPrimaryScreenChanged(QScreen *screen);
 
 private:
     QRect m_screenRect;
     Activity *m_acticity;
     bool m_twentyFourTime;
+    int m_prewarmDelay;
+
+    struct PendingTrayMenu {
+        QDBusMessage message;
+        QElapsedTimer timer;
+        quint64 serial = 0;
+    };
+    QHash<QString, PendingTrayMenu> m_pendingTrayMenus;
+    quint64 m_trayMenuSerial;
 };
 
 #endif // STATUSBAR_H
@@ -24,8 +24,13 @@
 #include "systemtraytypes.h"
 
 #include "../libdbusmenuqt/dbusmenuimporter.h"
+#include "../dbusmenuregistry.h"
+#include "../wakeupmonitor.h"
+#include "../ecomode.h"
+#include "../tracer.h"
 
 #include <QDebug>
+#include <QHash>
 #include <netinet/in.h>
 
 class TrayMenuImporter : public DBusMenuImporter
@@ -49,6 +54,7 @@ StatusNotifierItemSource::StatusNotifierItemSource(const QString &notifierItemId
     , m_tooltipUpdate(true)
     , m_statusUpdate(true)
     , m_id(notifierItemId)
+    , m_iconPixmapHash(0)
 {
     setObjectName(notifierItemId);
 
@@ -92,6 +98,8 @@ StatusNotifierItemSource::~StatusNotifierItemSource()
 {
     if (m_statusNotifierItemInterface)
         delete m_statusNotifierItemInterface;
+
+    DBusMenuRegistry::self()->release(m_menuImporter);
 }
 
 QString StatusNotifierItemSource::id() const
@@ -129,6 +137,11 @@ QIcon StatusNotifierItemSource::icon() const
     return m_icon;
 }
 
+bool StatusNotifierItemSource::hasMenu() const
+{
+    return m_menuImporter != nullptr;
+}
+
 void StatusNotifierItemSource::activate(int x, int y)
 {
     if (m_statusNotifierItemInterface && m_statusNotifierItemInterface->isValid()) {
@@ -200,18 +213,21 @@ void StatusNotifierItemSource::contextMenuReady()
 
 void StatusNotifierItemSource::refreshTitle()
 {
+    WakeupMonitor::dbusMessage(m_statusNotifierItemInterface->service(), QStringLiteral("NewTitle"));
     m_titleUpdate = true;
     refresh();
 }
 
 void StatusNotifierItemSource::refreshIcons()
 {
+    WakeupMonitor::dbusMessage(m_statusNotifierItemInterface->service(), QStringLiteral("NewIcon"));
     m_iconUpdate = true;
     refresh();
 }
 
 void StatusNotifierItemSource::refreshToolTip()
 {
+    WakeupMonitor::dbusMessage(m_statusNotifierItemInterface->service(), QStringLiteral("NewToolTip"));
     m_tooltipUpdate = true;
     refresh();
 }
@@ -219,7 +235,7 @@ void StatusNotifierItemSource::refreshToolTip()
 void StatusNotifierItemSource::refresh()
 {
     if (!m_refreshTimer.isActive()) {
-        m_refreshTimer.start();
+        m_refreshTimer.start(EcoMode::self()->trayRefreshInterval());
     }
 }
 
@@ -240,15 +256,18 @@ void StatusNotifierItemSource::performRefresh()
     QDBusPendingCall call = m_statusNotifierItemInterface->connection().asyncCall(message);
     QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(call, this);
     connect(watcher, &QDBusPendingCallWatcher::finished, this, &StatusNotifierItemSource::refreshCallback);
+    Tracer::asyncCall(watcher, "SNI GetAll", m_statusNotifierItemInterface->service(), m_statusNotifierItemInterface->path());
 }
 
 void StatusNotifierItemSource::syncStatus(QString)
 {
+    WakeupMonitor::dbusMessage(m_statusNotifierItemInterface->service(), QStringLiteral("NewStatus"));
 
 }
 
 void StatusNotifierItemSource::refreshCallback(QDBusPendingCallWatcher *call)
 {
+    WakeupMonitor::dbusMessage(m_statusNotifierItemInterface->service(), QStringLiteral("GetAll"));
     m_refreshing = false;
     if (m_needsReRefreshing) {
         m_needsReRefreshing = false;
@@ -291,7 +310,14 @@ void StatusNotifierItemSource::refreshCallback(QDBusPendingCallWatcher *call)
         KDbusImageVector image;
         properties[QStringLiteral("IconPixmap")].value<QDBusArgument>() >> image;
         if (!image.isEmpty()) {
-            m_icon = imageVectorToPixmap(image);
+            size_t hash = 0;
+            for (const KDbusImageStruct &pixmap : std::as_const(image))
+                hash = qHashMulti(hash, pixmap.width, pixmap.height, pixmap.data);
+
+            if (hash != m_iconPixmapHash || m_icon.isNull()) {
+                m_iconPixmapHash = hash;
+                m_icon = imageVectorToPixmap(image);
+            }
         }
 
         // Menu
@@ -304,8 +330,8 @@ void StatusNotifierItemSource::refreshCallback(QDBusPendingCallWatcher *call)
                     // KStatusNotifierItem::setContextMenu().
                     qWarning() << "DBusMenu disabled for this application";
                 } else {
-                    m_menuImporter = new TrayMenuImporter(m_statusNotifierItemInterface->service(),
-                                                      menuObjectPath, this);
+                    m_menuImporter = DBusMenuRegistry::self()->acquire<TrayMenuImporter>(m_statusNotifierItemInterface->service(),
+                                                                                         menuObjectPath);
                     connect(m_menuImporter, &TrayMenuImporter::menuUpdated, this, [this](QMenu *menu) {
                         if (menu == m_menuImporter->menu()) {
                             contextMenuReady();
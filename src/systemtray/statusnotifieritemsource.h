@@ -49,6 +49,7 @@ public:
     QString subtitle() const;
     QString iconName() const;
     QIcon icon() const;
+    bool hasMenu() const;
 
     void activate(int x, int y);
     void secondaryActivate(int x, int y);
@@ -95,6 +96,11 @@ private:
     QString m_subTitle;
     QString m_iconName;
     QIcon m_icon;
+    // Hash of the IconPixmap m_icon was built from, m_icon keeps its
+    // cacheKey while the item resends the same pixels.
+    size_t m_iconPixmapHash;
+
+    friend class StatusBarBenchmark;
 };
 
 #endif // STATUSNOTIFIERITEMSOURCE_H
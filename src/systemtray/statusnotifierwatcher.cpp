@@ -25,30 +25,38 @@
 #include "statusnotifierwatcheradaptor.h"
 
 #include <QDBusConnection>
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
 #include <QDBusServiceWatcher>
 #include <QDebug>
 
 StatusNotifierWatcher::StatusNotifierWatcher(QObject *parent)
     : QObject(parent)
 {
-    // 检查服务是否已经存在
     QDBusConnection dbus = QDBusConnection::sessionBus();
-    QDBusConnectionInterface *iface = dbus.interface();
-    
+
     // 总是创建adaptor和对象，这样DBus调用才能被处理
     new StatusNotifierWatcherAdaptor(this);
     dbus.registerObject(QStringLiteral("/StatusNotifierWatcher"), this);
-    
-    // 检查服务是否已经存在，避免重复注册
-    if (iface && iface->isServiceRegistered(QStringLiteral("org.kde.StatusNotifierWatcher")).value()) {
-        qWarning() << "org.kde.StatusNotifierWatcher service already registered by another instance";
-        // 不注册服务，但继续初始化其他部分
-    } else {
-        // 注册服务
-        if (!dbus.registerService(QStringLiteral("org.kde.StatusNotifierWatcher"))) {
-            qWarning() << "Failed to register org.kde.StatusNotifierWatcher service";
-        }
-    }
+
+    // Ask for the name without waiting. DO_NOT_QUEUE makes the bus refuse it
+    // when another watcher already owns it, instead of queueing us behind it.
+    QDBusMessage request = QDBusMessage::createMethodCall(QStringLiteral("org.freedesktop.DBus"),
+                                                          QStringLiteral("/org/freedesktop/DBus"),
+                                                          QStringLiteral("org.freedesktop.DBus"),
+                                                          QStringLiteral("RequestName"));
+    request << QStringLiteral("org.kde.StatusNotifierWatcher") << uint(0x4);
+
+    QDBusPendingCallWatcher *requestWatcher = new QDBusPendingCallWatcher(dbus.asyncCall(request), this);
+    connect(requestWatcher, &QDBusPendingCallWatcher::finished, this, [] (QDBusPendingCallWatcher *watcher) {
+        QDBusPendingReply<uint> reply = *watcher;
+        watcher->deleteLater();
+
+        if (reply.isError())
+            qWarning() << "Failed to register org.kde.StatusNotifierWatcher service" << reply.error().message();
+        else if (reply.value() == 3)
+            qWarning() << "org.kde.StatusNotifierWatcher service already registered by another instance";
+    });
 
     m_serviceWatcher = new QDBusServiceWatcher(this);
     m_serviceWatcher->setConnection(dbus);
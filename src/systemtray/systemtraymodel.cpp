@@ -19,22 +19,28 @@
  ***************************************************************************/
 
 #include "systemtraymodel.h"
+#include "trayiconprovider.h"
 
 #include <QApplication>
 #include <QDebug>
 
 #include <KWindowSystem>
 
-static QStringList noColorOverlayList = {
-    "netease-cloud-music",
-    "chrome_status_icon_1",
-    "35682", // obs studio
-    "lark_status_icon_1"
-};
+#include <utility>
+
+// How long openMenu() waits for an item's layout.
+static const int s_menuTimeout = 5000;
 
 SystemTrayModel::SystemTrayModel(QObject *parent)
     : QAbstractListModel(parent)
+    , m_moveFrom(-1)
+    , m_moveTo(-1)
 {
+    // DropArea reports every entered delegate, apply at most one move per frame.
+    m_moveTimer.setSingleShot(true);
+    m_moveTimer.setInterval(16);
+    connect(&m_moveTimer, &QTimer::timeout, this, &SystemTrayModel::applyMove);
+
     m_watcher = new StatusNotifierWatcher;
     m_sniHost = StatusNotifierItemHost::self();
 
@@ -66,6 +72,7 @@ QHash<int, QByteArray> SystemTrayModel::roleNames() const
     roles[TitleRole] = "title";
     roles[ToolTipRole] = "toolTip";
     roles[CanColorOverlay] = "canColorOverlay";
+    roles[IconKeyRole] = "iconKey";
     return roles;
 }
 
@@ -92,7 +99,9 @@ QVariant SystemTrayModel::data(const QModelIndex &index, int role) const
     case ToolTipRole:
         return item->tooltip();
     case CanColorOverlay:
-        return !noColorOverlayList.contains(item->appId());
+        return TrayIconProvider::canColorOverlay(item->appId());
+    case IconKeyRole:
+        return m_iconKeys.value(item->id());
     }
 
     return QVariant();
@@ -100,7 +109,7 @@ QVariant SystemTrayModel::data(const QModelIndex &index, int role) const
 
 int SystemTrayModel::indexOf(const QString &id)
 {
-    for (StatusNotifierItemSource *item : qAsConst(m_items)) {
+    for (StatusNotifierItemSource *item : std::as_const(m_items)) {
         if (item->id() == id)
             return m_items.indexOf(item);
     }
@@ -149,18 +158,75 @@ void SystemTrayModel::middleButtonClick(const QString &id, int x, int y)
     }
 }
 
-void SystemTrayModel::move(int from, int to)
+bool SystemTrayModel::openMenu(const QString &id)
+{
+    StatusNotifierItemSource *item = findItemById(id);
+
+    if (!item || !item->hasMenu() || m_pendingMenus.contains(id))
+        return false;
+
+    // The layout may never arrive, e.g. on a GetLayout error.
+    PendingMenu pending;
+    pending.ready = connect(item, qOverload<QMenu *>(&StatusNotifierItemSource::contextMenuReady), this, [=] {
+        finishMenu(id, true);
+    });
+    pending.timeout = new QTimer(this);
+    pending.timeout->setSingleShot(true);
+    connect(pending.timeout, &QTimer::timeout, this, [=] {
+        finishMenu(id, false);
+    });
+    pending.timeout->start(s_menuTimeout);
+    m_pendingMenus.insert(id, pending);
+
+    item->contextMenu(0, 0, nullptr);
+    return true;
+}
+
+void SystemTrayModel::finishMenu(const QString &id, bool ok)
 {
-    if (from == to)
+    if (!m_pendingMenus.contains(id))
         return;
 
-    m_items.move(from, to);
+    const PendingMenu pending = m_pendingMenus.take(id);
+    disconnect(pending.ready);
+    pending.timeout->stop();
+    pending.timeout->deleteLater();
+
+    emit menuOpened(id, ok);
+}
+
+void SystemTrayModel::move(int from, int to)
+{
+    // The dragged index only changes once a move is applied.
+    if (m_moveTimer.isActive() && from != m_moveFrom)
+        applyMove();
+
+    m_moveFrom = from;
+    m_moveTo = to;
+
+    if (!m_moveTimer.isActive())
+        m_moveTimer.start();
+}
+
+void SystemTrayModel::applyMove()
+{
+    m_moveTimer.stop();
+
+    const int from = m_moveFrom;
+    const int to = m_moveTo;
+    m_moveFrom = m_moveTo = -1;
+
+    if (from == to || from < 0 || to < 0
+            || from >= m_items.size() || to >= m_items.size())
+        return;
 
     if (from < to)
         beginMoveRows(QModelIndex(), from, from, QModelIndex(), to + 1);
     else
         beginMoveRows(QModelIndex(), from, from, QModelIndex(), to);
 
+    m_items.move(from, to);
+
     endMoveRows();
 }
 
@@ -187,6 +253,11 @@ void SystemTrayModel::onItemAdded(const QString &service)
 
     connect(source, &StatusNotifierItemSource::updated, this, &SystemTrayModel::updated);
 
+    if (m_moveTimer.isActive())
+        applyMove();
+
+    updateIconKey(source);
+
     beginInsertRows(QModelIndex(), rowCount(), rowCount());
     m_items.append(source);
     endInsertRows();
@@ -194,12 +265,17 @@ void SystemTrayModel::onItemAdded(const QString &service)
 
 void SystemTrayModel::onItemRemoved(const QString &service)
 {
+    if (m_moveTimer.isActive())
+        applyMove();
+
     int index = indexOf(service);
 
     if (index != -1) {
         beginRemoveRows(QModelIndex(), index, index);
         StatusNotifierItemSource *item = m_items.at(index);
         m_items.removeAll(item);
+        m_iconKeys.remove(item->id());
+        TrayIconProvider::removeIcon(item->id());
         endRemoveRows();
     }
 }
@@ -213,6 +289,14 @@ void SystemTrayModel::updated(StatusNotifierItemSource *item)
 
     // update
     if (idx != -1) {
+        updateIconKey(item);
         emit dataChanged(index(idx, 0), index(idx, 0));
     }
 }
+
+void SystemTrayModel::updateIconKey(StatusNotifierItemSource *item)
+{
+    // The key only changes with the icon, so the Image reloads only then.
+    m_iconKeys.insert(item->id(), TrayIconProvider::setIcon(item->id(), item->iconName(),
+                                                            item->icon(), item->appId()));
+}
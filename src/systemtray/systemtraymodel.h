@@ -25,6 +25,8 @@
 
 #include <QQuickItem>
 #include <QQuickWindow>
+#include <QTimer>
+#include <QQmlEngine>
 
 #include "statusnotifierwatcher.h"
 #include "statusnotifieritemhost.h"
@@ -33,6 +35,7 @@
 class SystemTrayModel : public QAbstractListModel
 {
     Q_OBJECT
+    QML_ELEMENT
 
 public:
     enum Roles {
@@ -41,7 +44,8 @@ public:
         IconRole,
         TitleRole,
         ToolTipRole,
-        CanColorOverlay
+        CanColorOverlay,
+        IconKeyRole
     };
 
     explicit SystemTrayModel(QObject *parent = nullptr);
@@ -59,6 +63,11 @@ public:
     Q_INVOKABLE void rightButtonClick(const QString &id, QQuickItem *iconItem, int x, int y);
     Q_INVOKABLE void middleButtonClick(const QString &id, int x, int y);
 
+    // Pops up the menu without an icon to anchor it to, menuOpened()
+    // follows once the layout has been applied or the request timed out.
+    // Returns false while a request for the same item is still pending.
+    Q_INVOKABLE bool openMenu(const QString &id);
+
     Q_INVOKABLE void move(int from, int to);
 
     /**
@@ -68,16 +77,37 @@ public:
      */
     Q_INVOKABLE QPointF popupPosition(QQuickItem *visualParent, int x, int y);
 
+signals:
+    void menuOpened(const QString &id, bool ok);
+
 private slots:
     void onItemAdded(const QString &service);
     void onItemRemoved(const QString &service);
     void updated(StatusNotifierItemSource *item);
+    void applyMove();
+
+private:
+    void updateIconKey(StatusNotifierItemSource *item);
+    void finishMenu(const QString &id, bool ok);
 
 private:
     StatusNotifierWatcher *m_watcher;
     StatusNotifierItemHost *m_sniHost;
     QList<StatusNotifierItemSource *> m_items;
+    QHash<QString, QString> m_iconKeys;
+
+    struct PendingMenu {
+        QMetaObject::Connection ready;
+        QTimer *timeout;
+    };
+    QHash<QString, PendingMenu> m_pendingMenus;
+
+    QTimer m_moveTimer;
+    int m_moveFrom;
+    int m_moveTo;
     QString m_hostName;
+
+    friend class StatusBarBenchmark;
 };
 
 #endif // SYSTEMTRAYMODEL_H
@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2021 CutefishOS Team.
+ *
+ * Author:     cutefishos <cutefishos@foxmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "trayiconprovider.h"
+
+#include <QCache>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPainter>
+#include <QUrlQuery>
+
+static const QStringList s_noColorOverlayList = {
+    "netease-cloud-music",
+    "chrome_status_icon_1",
+    "35682", // obs studio
+    "lark_status_icon_1"
+};
+
+struct TrayIconEntry
+{
+    QString key;
+    QIcon icon;
+    bool tint = false;
+
+    // What the icon was made from, an unchanged item keeps its key.
+    QString iconName;
+    QString appId;
+    qint64 sourceKey = 0;
+};
+
+// Shared between the GUI thread and image loader threads.
+static QMutex s_mutex;
+static QHash<QString, TrayIconEntry> s_entries;
+static QHash<QString, QString> s_itemKeys;
+static QCache<QString, QImage> s_images(256);
+static quint64 s_serial = 0;
+
+TrayIconProvider::TrayIconProvider()
+    : QQuickImageProvider(QQuickImageProvider::Image)
+{
+}
+
+QImage TrayIconProvider::requestImage(const QString &id, QSize *size, const QSize &requestedSize)
+{
+    const int queryPos = id.indexOf(QLatin1Char('?'));
+    const QString key = id.left(queryPos);
+    const QUrlQuery query(queryPos >= 0 ? id.mid(queryPos + 1) : QString());
+    const QString colorName = query.queryItemValue(QStringLiteral("color"));
+    const QColor color = colorName.isEmpty() ? QColor() : QColor(QLatin1Char('#') + colorName);
+
+    // requestedSize is the sourceSize already scaled by the device pixel ratio.
+    // Drag images have no sourceSize and pass their pixel size in the query.
+    QSize target = requestedSize;
+    if (!target.isValid()) {
+        const int extent = query.queryItemValue(QStringLiteral("size")).toInt();
+        target = extent > 0 ? QSize(extent, extent) : QSize(64, 64);
+    }
+
+    QMutexLocker locker(&s_mutex);
+
+    const auto it = s_entries.constFind(key);
+    if (it == s_entries.constEnd())
+        return QImage();
+
+    const bool tint = it->tint && color.isValid();
+    const QString cacheKey = QStringLiteral("%1|%2|%3x%4").arg(key, tint ? color.name() : QString())
+                                                           .arg(target.width()).arg(target.height());
+
+    if (QImage *cached = s_images.object(cacheKey)) {
+        if (size)
+            *size = cached->size();
+        return *cached;
+    }
+
+    const QIcon icon = it->icon;
+    locker.unlock();
+
+    // target is in device pixels already, don't let QIcon scale it again.
+    QImage image = icon.pixmap(target, 1.0).toImage().convertToFormat(QImage::Format_ARGB32_Premultiplied);
+
+    if (tint && !image.isNull()) {
+        QPainter painter(&image);
+        painter.setCompositionMode(QPainter::CompositionMode_SourceIn);
+        painter.fillRect(image.rect(), color);
+    }
+
+    if (size)
+        *size = image.size();
+
+    locker.relock();
+    s_images.insert(cacheKey, new QImage(image));
+
+    return image;
+}
+
+QString TrayIconProvider::setIcon(const QString &itemId, const QString &iconName, const QIcon &icon, const QString &appId)
+{
+    {
+        QMutexLocker locker(&s_mutex);
+
+        const auto it = s_entries.constFind(s_itemKeys.value(itemId));
+        if (it != s_entries.constEnd() && it->iconName == iconName
+                && it->appId == appId && it->sourceKey == icon.cacheKey())
+            return it->key;
+    }
+
+    TrayIconEntry entry;
+    entry.key = QString::number(++s_serial);
+    entry.tint = canColorOverlay(appId);
+    entry.iconName = iconName;
+    entry.appId = appId;
+    entry.sourceKey = icon.cacheKey();
+
+    if (!iconName.isEmpty())
+        entry.icon = iconName.startsWith(QLatin1Char('/')) ? QIcon(iconName) : QIcon::fromTheme(iconName);
+
+    if (entry.icon.isNull())
+        entry.icon = icon;
+
+    QMutexLocker locker(&s_mutex);
+
+    // Tinted copies of the old icon are left to age out of the cache.
+    s_entries.remove(s_itemKeys.value(itemId));
+    s_itemKeys.insert(itemId, entry.key);
+    s_entries.insert(entry.key, entry);
+
+    return entry.key;
+}
+
+void TrayIconProvider::removeIcon(const QString &itemId)
+{
+    QMutexLocker locker(&s_mutex);
+    s_entries.remove(s_itemKeys.take(itemId));
+}
+
+bool TrayIconProvider::canColorOverlay(const QString &appId)
+{
+    return !s_noColorOverlayList.contains(appId);
+}
@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2021 CutefishOS Team.
+ *
+ * Author:     cutefishos <cutefishos@foxmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TRAYICONPROVIDER_H
+#define TRAYICONPROVIDER_H
+
+#include <QQuickImageProvider>
+#include <QIcon>
+
+/**
+ * Serves tray icons as image://trayicon/<key>[?color=rrggbb][&size=px].
+ *
+ * Symbolic icons are recolored here once per key, color and size and the
+ * result is shared by every request, so QML needs no shader effect.
+ */
+class TrayIconProvider : public QQuickImageProvider
+{
+public:
+    TrayIconProvider();
+
+    QImage requestImage(const QString &id, QSize *size, const QSize &requestedSize) override;
+
+    // Called from the GUI thread whenever an item is updated, returns the
+    // item's current key when its icon did not change.
+    static QString setIcon(const QString &itemId, const QString &iconName, const QIcon &icon, const QString &appId);
+    static void removeIcon(const QString &itemId);
+
+    static bool canColorOverlay(const QString &appId);
+};
+
+#endif // TRAYICONPROVIDER_H
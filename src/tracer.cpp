@@ -0,0 +1,210 @@
+/*
+ * Copyright (C) 2021 CutefishOS Team.
+ *
+ * Author:     cutefishos <cutefishos@foxmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tracer.h"
+
+#include <QCoreApplication>
+#include <QDBusPendingCallWatcher>
+#include <QQuickWindow>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QThread>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QAtomicInt>
+#include <QFile>
+#include <QDebug>
+
+#include <utility>
+
+// Events are written in batches of this size and when the bar quits.
+static const int s_batchSize = 256;
+
+bool Tracer::s_enabled = false;
+
+static QMutex s_mutex;
+static QFile *s_file = nullptr;
+static QList<QByteArray> s_pending;
+static QElapsedTimer s_clock;
+static qint64 s_pid = 0;
+static QAtomicInt s_nextThread(1);
+static QAtomicInt s_nextAsync(1);
+
+static int threadId()
+{
+    static thread_local int id = 0;
+
+    if (!id) {
+        id = s_nextThread.fetchAndAddRelaxed(1);
+
+        // Name the thread once in the trace.
+        QJsonObject event;
+        event["ph"] = "M";
+        event["name"] = "thread_name";
+        event["pid"] = s_pid;
+        event["tid"] = id;
+        const QString name = QThread::currentThread()->objectName();
+        event["args"] = QJsonObject{{"name", name.isEmpty() ? QString("thread %1").arg(id) : name}};
+
+        QMutexLocker locker(&s_mutex);
+        s_pending.append(QJsonDocument(event).toJson(QJsonDocument::Compact));
+    }
+
+    return id;
+}
+
+static void append(QJsonObject event)
+{
+    event["ts"] = s_clock.nsecsElapsed() / 1000.0;
+    event["pid"] = s_pid;
+    event["tid"] = threadId();
+
+    const QByteArray line = QJsonDocument(event).toJson(QJsonDocument::Compact);
+
+    QMutexLocker locker(&s_mutex);
+    s_pending.append(line);
+
+    if (s_pending.size() >= s_batchSize) {
+        locker.unlock();
+        Tracer::flush();
+    }
+}
+
+void Tracer::init()
+{
+    const QString fileName = qEnvironmentVariable("CUTEFISH_STATUSBAR_TRACE");
+
+    if (fileName.isEmpty())
+        return;
+
+    s_file = new QFile(fileName);
+
+    if (!s_file->open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "StatusBar: cannot write trace to" << fileName;
+        delete s_file;
+        s_file = nullptr;
+        return;
+    }
+
+    // The JSON array format allows the closing bracket to be missing,
+    // so a trace cut short by a crash still opens.
+    s_file->write("[\n");
+
+    s_pid = QCoreApplication::applicationPid();
+    s_clock.start();
+    s_enabled = true;
+
+    QThread::currentThread()->setObjectName(QStringLiteral("GUI"));
+    qAddPostRoutine(flush);
+
+    qDebug() << "StatusBar: tracing to" << fileName;
+}
+
+void Tracer::begin(const char *category, const char *name, const QVariantMap &args)
+{
+    if (!s_enabled)
+        return;
+
+    QJsonObject event;
+    event["ph"] = "B";
+    event["cat"] = category;
+    event["name"] = name;
+    if (!args.isEmpty())
+        event["args"] = QJsonObject::fromVariantMap(args);
+
+    append(event);
+}
+
+void Tracer::end(const char *category, const char *name)
+{
+    if (!s_enabled)
+        return;
+
+    QJsonObject event;
+    event["ph"] = "E";
+    event["cat"] = category;
+    event["name"] = name;
+
+    append(event);
+}
+
+void Tracer::asyncCall(QDBusPendingCallWatcher *watcher, const char *name,
+                       const QString &service, const QString &path)
+{
+    if (!s_enabled || !watcher)
+        return;
+
+    const int id = s_nextAsync.fetchAndAddRelaxed(1);
+
+    QJsonObject event;
+    event["ph"] = "b";
+    event["cat"] = "dbus";
+    event["name"] = name;
+    event["id"] = id;
+    event["args"] = QJsonObject{{"service", service}, {"path", path}};
+    append(event);
+
+    QObject::connect(watcher, &QDBusPendingCallWatcher::finished, [id, name] (QDBusPendingCallWatcher *watcher) {
+        QJsonObject event;
+        event["ph"] = "e";
+        event["cat"] = "dbus";
+        event["name"] = name;
+        event["id"] = id;
+        if (watcher->isError())
+            event["args"] = QJsonObject{{"error", watcher->error().name()}};
+        append(event);
+    });
+}
+
+void Tracer::watchWindow(QQuickWindow *window)
+{
+    if (!s_enabled)
+        return;
+
+    // Emitted on the render thread, keep them there.
+    QObject::connect(window, &QQuickWindow::beforeSynchronizing, window, [] {
+        begin("qml", "sync");
+    }, Qt::DirectConnection);
+    QObject::connect(window, &QQuickWindow::afterSynchronizing, window, [] {
+        end("qml", "sync");
+    }, Qt::DirectConnection);
+    QObject::connect(window, &QQuickWindow::beforeRendering, window, [] {
+        begin("qml", "render");
+    }, Qt::DirectConnection);
+    QObject::connect(window, &QQuickWindow::afterRendering, window, [] {
+        end("qml", "render");
+    }, Qt::DirectConnection);
+}
+
+void Tracer::flush()
+{
+    QMutexLocker locker(&s_mutex);
+
+    if (!s_file || s_pending.isEmpty())
+        return;
+
+    for (const QByteArray &line : std::as_const(s_pending)) {
+        s_file->write(line);
+        s_file->write(",\n");
+    }
+
+    s_pending.clear();
+    s_file->flush();
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2021 CutefishOS Team.
+ *
+ * Author:     cutefishos <cutefishos@foxmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <QString>
+#include <QVariantMap>
+
+#include <utility>
+
+class QDBusPendingCallWatcher;
+class QQuickWindow;
+
+/**
+ * Records spans in the Chrome trace event format, which Perfetto and
+ * chrome://tracing open directly.
+ *
+ * Tracing is off unless CUTEFISH_STATUSBAR_TRACE names the output file.
+ * When it is off every entry point returns after testing one flag.
+ */
+class Tracer
+{
+public:
+    static void init();
+    static inline bool enabled() { return s_enabled; }
+
+    // Spans on the calling thread, begin and end must nest.
+    static void begin(const char *category, const char *name, const QVariantMap &args = QVariantMap());
+    static void end(const char *category, const char *name);
+
+    // Spans a pending DBus call until its reply arrives.
+    static void asyncCall(QDBusPendingCallWatcher *watcher, const char *name,
+                          const QString &service, const QString &path);
+
+    // Spans the scene graph sync and render of every frame.
+    static void watchWindow(QQuickWindow *window);
+
+    static void flush();
+
+private:
+    static bool s_enabled;
+};
+
+/**
+ * Scoped span, e.g.
+ *
+ *     TraceSpan span("x11", "GetProperty", [&] { return QVariantMap {{"window", id}}; });
+ *
+ * Arguments are passed as a function so they are only built while tracing.
+ */
+class TraceSpan
+{
+public:
+    TraceSpan(const char *category, const char *name)
+        : m_category(category)
+        , m_name(name)
+        , m_active(Tracer::enabled())
+    {
+        if (m_active)
+            Tracer::begin(category, name);
+    }
+
+    template<typename Args, typename = decltype(QVariantMap(std::declval<Args>()()))>
+    TraceSpan(const char *category, const char *name, Args &&args)
+        : m_category(category)
+        , m_name(name)
+        , m_active(Tracer::enabled())
+    {
+        if (m_active)
+            Tracer::begin(category, name, std::forward<Args>(args)());
+    }
+
+    ~TraceSpan()
+    {
+        if (m_active)
+            Tracer::end(m_category, m_name);
+    }
+
+private:
+    Q_DISABLE_COPY(TraceSpan)
+
+    const char *m_category;
+    const char *m_name;
+    bool m_active;
+};
+
+#endif // TRACER_H
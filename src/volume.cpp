@@ -20,10 +20,6 @@
 #include "volume.h"
 
 #include <QDBusConnection>
-#include <QDBusInterface>
-#include <QDBusReply>
-#include <QDBusServiceWatcher>
-#include <QDBusPendingCall>
 
 static const QString Service = "com.cutefish.Settings";
 static const QString ObjectPath = "/Audio";
@@ -39,19 +35,30 @@ VolumeManager *VolumeManager::self()
     return SELF;
 }
 
+VolumeManager *VolumeManager::create(QQmlEngine *, QJSEngine *)
+{
+    // Shared with the C++ side, the engine must not take ownership.
+    QJSEngine::setObjectOwnership(self(), QJSEngine::CppOwnership);
+    return self();
+}
+
 VolumeManager::VolumeManager(QObject *parent)
     : QObject(parent)
+    , m_properties(Service, ObjectPath, Interface, QDBusConnection::sessionBus())
+    , m_volumeWriter(&m_properties, "setVolume", "volume")
+    , m_muteWriter(&m_properties, "setMute", "mute")
     , m_isValid(false)
     , m_isMute(false)
     , m_volume(0)
 {
-    QDBusServiceWatcher *watcher = new QDBusServiceWatcher(this);
-    watcher->setConnection(QDBusConnection::sessionBus());
-    watcher->addWatchedService(Service);
-
-    init();
-
-    connect(watcher, &QDBusServiceWatcher::serviceRegistered, this, &VolumeManager::init);
+    m_properties.watchSignal("volumeChanged", "volume");
+    m_properties.watchSignal("muteChanged", "mute");
+
+    connect(&m_properties, &DBusPropertyCache::propertyChanged, this, &VolumeManager::onPropertyChanged);
+    connect(&m_properties, &DBusPropertyCache::ready, this, [=] {
+        m_isValid = true;
+        emit validChanged();
+    });
 }
 
 bool VolumeManager::isValid() const
@@ -59,58 +66,21 @@ bool VolumeManager::isValid() const
     return m_isValid;
 }
 
-void VolumeManager::initStatus()
+void VolumeManager::onPropertyChanged(const QString &name, const QVariant &value)
 {
-    QDBusInterface iface(Service, ObjectPath, Interface, QDBusConnection::sessionBus(), this);
-
-    m_isValid = iface.isValid() && !iface.lastError().isValid();
-
-    if (m_isValid) {
-        int volume = iface.property("volume").toInt();
-        bool mute = iface.property("mute").toBool();
-
-        if (m_volume != volume) {
-            m_volume = volume;
+    if (name == "volume") {
+        if (m_volume != value.toInt()) {
+            m_volume = value.toInt();
             emit volumeChanged();
         }
-
-        if (m_isMute != mute) {
-            m_isMute = mute;
+    } else if (name == "mute") {
+        if (m_isMute != value.toBool()) {
+            m_isMute = value.toBool();
             emit muteChanged();
-        }
-    }
-
-    emit validChanged();
-}
-
-void VolumeManager::connectDBusSignals()
-{
-    QDBusInterface iface(Service, ObjectPath, Interface, QDBusConnection::sessionBus(), this);
-
-    if (iface.isValid()) {
-        QDBusConnection::sessionBus().connect(Service, ObjectPath, Interface, "volumeChanged",
-                                              this, SLOT(onDBusVolumeChanged(int)));
-        QDBusConnection::sessionBus().connect(Service, ObjectPath, Interface, "muteChanged",
-                                              this, SLOT(onDBusMuteChanged(bool)));
-    }
-}
 
-void VolumeManager::onDBusVolumeChanged(int volume)
-{
-    if (m_volume != volume) {
-        m_volume = volume;
-        emit volumeChanged();
-    }
-}
-
-void VolumeManager::onDBusMuteChanged(bool mute)
-{
-    if (m_isMute != mute) {
-        m_isMute = mute;
-        emit muteChanged();
-
-        // Need to update the icon.
-        emit volumeChanged();
+            // Need to update the icon.
+            emit volumeChanged();
+        }
     }
 }
 
@@ -133,35 +103,18 @@ QString VolumeManager::iconName() const
 
 void VolumeManager::toggleMute()
 {
-    QDBusInterface iface(Service, ObjectPath, Interface, QDBusConnection::sessionBus(), this);
-
-    if (iface.isValid()) {
-        iface.call("toggleMute");
-    }
+    // Goes through the same writer so it can't race a pending setMute.
+    setMute(!m_isMute);
 }
 
 void VolumeManager::setMute(bool mute)
 {
-    QDBusInterface iface(Service, ObjectPath, Interface, QDBusConnection::sessionBus(), this);
-
-    if (iface.isValid()) {
-        iface.call("setMute", QVariant::fromValue(mute));
-    }
+    m_muteWriter.write(mute);
 }
 
 void VolumeManager::setVolume(int value)
 {
-    QDBusInterface iface(Service, ObjectPath, Interface, QDBusConnection::sessionBus(), this);
-
-    if (iface.isValid()) {
-        iface.call("setVolume", QVariant::fromValue(value));
-    }
-}
-
-void VolumeManager::init()
-{
-    initStatus();
-    connectDBusSignals();
+    m_volumeWriter.write(value);
 }
 
 bool VolumeManager::isMute() const
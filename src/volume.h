@@ -21,10 +21,16 @@
 #define VOLUMEMANAGER_H
 
 #include <QObject>
+#include <QQmlEngine>
+
+#include "dbuspropertycache.h"
+#include "dbuswritecoalescer.h"
 
 class VolumeManager : public QObject
 {
     Q_OBJECT
+    QML_NAMED_ELEMENT(Volume)
+    QML_SINGLETON
     Q_PROPERTY(bool isValid READ isValid NOTIFY validChanged)
     Q_PROPERTY(bool isMute READ isMute NOTIFY muteChanged)
     Q_PROPERTY(int volume READ volume NOTIFY volumeChanged)
@@ -32,6 +38,7 @@ class VolumeManager : public QObject
 
 public:
     static VolumeManager *self();
+    static VolumeManager *create(QQmlEngine *, QJSEngine *);
 
     explicit VolumeManager(QObject *parent = nullptr);
 
@@ -50,16 +57,14 @@ signals:
     void muteChanged();
     void volumeChanged();
 
-private:
-    void init();
-    void initStatus();
-    void connectDBusSignals();
-
 private slots:
-    void onDBusVolumeChanged(int volume);
-    void onDBusMuteChanged(bool mute);
+    void onPropertyChanged(const QString &name, const QVariant &value);
 
 private:
+    DBusPropertyCache m_properties;
+    DBusWriteCoalescer m_volumeWriter;
+    DBusWriteCoalescer m_muteWriter;
+
     bool m_isValid;
     bool m_isMute;
     int m_volume;
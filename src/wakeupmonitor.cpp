@@ -0,0 +1,281 @@
+/*
+ * Copyright (C) 2021 CutefishOS Team.
+ *
+ * Author:     cutefishos <cutefishos@foxmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "wakeupmonitor.h"
+
+#include <QAbstractEventDispatcher>
+#include <QCoreApplication>
+#include <QTimer>
+#include <QEvent>
+#include <QDebug>
+
+#include <xcb/xcb.h>
+
+#include <algorithm>
+
+static const int s_keptMinutes = 60;
+
+static WakeupMonitor *SELF = nullptr;
+
+static const char *xcbEventName(uint8_t type)
+{
+    switch (type) {
+    case XCB_KEY_PRESS: return "KeyPress";
+    case XCB_KEY_RELEASE: return "KeyRelease";
+    case XCB_BUTTON_PRESS: return "ButtonPress";
+    case XCB_BUTTON_RELEASE: return "ButtonRelease";
+    case XCB_MOTION_NOTIFY: return "MotionNotify";
+    case XCB_ENTER_NOTIFY: return "EnterNotify";
+    case XCB_LEAVE_NOTIFY: return "LeaveNotify";
+    case XCB_FOCUS_IN: return "FocusIn";
+    case XCB_FOCUS_OUT: return "FocusOut";
+    case XCB_EXPOSE: return "Expose";
+    case XCB_CREATE_NOTIFY: return "CreateNotify";
+    case XCB_DESTROY_NOTIFY: return "DestroyNotify";
+    case XCB_UNMAP_NOTIFY: return "UnmapNotify";
+    case XCB_MAP_NOTIFY: return "MapNotify";
+    case XCB_CONFIGURE_NOTIFY: return "ConfigureNotify";
+    case XCB_PROPERTY_NOTIFY: return "PropertyNotify";
+    case XCB_CLIENT_MESSAGE: return "ClientMessage";
+    default: return nullptr;
+    }
+}
+
+// Timers are named after the object that owns them.
+static QString timerOwner(QObject *receiver)
+{
+    QObject *owner = receiver;
+
+    if (qobject_cast<QTimer *>(receiver) && receiver->parent())
+        owner = receiver->parent();
+
+    QString name = QString::fromLatin1(owner->metaObject()->className());
+
+    if (!receiver->objectName().isEmpty())
+        name += QLatin1Char('/') + receiver->objectName();
+    else if (owner != receiver && !owner->objectName().isEmpty())
+        name += QLatin1Char('/') + owner->objectName();
+
+    return name;
+}
+
+WakeupMonitor *WakeupMonitor::self()
+{
+    if (!SELF)
+        SELF = new WakeupMonitor;
+
+    return SELF;
+}
+
+WakeupMonitor::WakeupMonitor(QObject *parent)
+    : QObject(parent)
+    , m_minute(0)
+    , m_enabled(false)
+    , m_awake(false)
+    , m_priority(NoSource)
+    , m_logging(qEnvironmentVariableIsSet("CUTEFISH_STATUSBAR_WAKEUPS"))
+{
+    m_clock.start();
+    m_minutes.append(QHash<QString, quint32>());
+
+    setEnabled(m_logging);
+}
+
+bool WakeupMonitor::enabled() const
+{
+    return m_enabled;
+}
+
+void WakeupMonitor::setEnabled(bool enabled)
+{
+    if (enabled == m_enabled)
+        return;
+
+    m_enabled = enabled;
+
+    QAbstractEventDispatcher *dispatcher = QAbstractEventDispatcher::instance();
+
+    if (enabled) {
+        if (dispatcher) {
+            connect(dispatcher, &QAbstractEventDispatcher::awake, this, &WakeupMonitor::onAwake);
+            connect(dispatcher, &QAbstractEventDispatcher::aboutToBlock, this, &WakeupMonitor::onAboutToBlock);
+        }
+
+        qApp->installEventFilter(this);
+        qApp->installNativeEventFilter(this);
+    } else {
+        if (dispatcher)
+            disconnect(dispatcher, nullptr, this, nullptr);
+
+        qApp->removeEventFilter(this);
+        qApp->removeNativeEventFilter(this);
+
+        m_awake = false;
+        m_priority = NoSource;
+    }
+}
+
+void WakeupMonitor::dbusMessage(const QString &service, const QString &member)
+{
+    if (SELF && SELF->wants(Specific))
+        SELF->attribute(QStringLiteral("dbus:") + service + QLatin1Char(' ') + member, Specific);
+}
+
+QVariantMap WakeupMonitor::counts(int minutes) const
+{
+    QVariantMap result;
+    const int n = qBound(1, minutes, m_minutes.size());
+
+    for (int i = 0; i < n; ++i) {
+        const QHash<QString, quint32> &minute = m_minutes.at(i);
+        for (auto it = minute.constBegin(); it != minute.constEnd(); ++it)
+            result[it.key()] = result.value(it.key()).toUInt() + it.value();
+    }
+
+    return result;
+}
+
+QString WakeupMonitor::report(int minutes) const
+{
+    const QVariantMap map = counts(minutes);
+
+    QList<QPair<quint32, QString>> sorted;
+    quint64 total = 0;
+    for (auto it = map.constBegin(); it != map.constEnd(); ++it) {
+        sorted.append(qMakePair(it.value().toUInt(), it.key()));
+        total += it.value().toUInt();
+    }
+
+    std::sort(sorted.begin(), sorted.end(), [] (const auto &a, const auto &b) {
+        return a.first > b.first;
+    });
+
+    QString text = QStringLiteral("%1 wakeups in the last %2 minute(s)\n").arg(total).arg(minutes);
+    for (const auto &entry : sorted)
+        text += QStringLiteral("%1 %2\n").arg(entry.first, 8).arg(entry.second);
+
+    return text;
+}
+
+bool WakeupMonitor::eventFilter(QObject *watched, QEvent *event)
+{
+    // Only the first event after a wakeup is interesting, names are built
+    // only for events that would be taken.
+    if (event->type() == QEvent::Timer) {
+        if (wants(Specific))
+            attribute(QStringLiteral("timer:") + timerOwner(watched), Specific);
+    } else if (wants(Generic)) {
+        switch (event->type()) {
+        case QEvent::SockAct:
+            attribute(QStringLiteral("socket"), Generic);
+            break;
+        case QEvent::MetaCall:
+            attribute(QStringLiteral("queued:") + QString::fromLatin1(watched->metaObject()->className()), Generic);
+            break;
+        default:
+            attribute(QStringLiteral("event:") + QString::number(event->type()), Generic);
+            break;
+        }
+    }
+
+    return QObject::eventFilter(watched, event);
+}
+
+bool WakeupMonitor::nativeEventFilter(const QByteArray &eventType, void *message, qintptr *result)
+{
+    Q_UNUSED(result)
+
+    if (!wants(Specific) || eventType != "xcb_generic_event_t")
+        return false;
+
+    auto *event = static_cast<xcb_generic_event_t *>(message);
+    const uint8_t type = event->response_type & ~0x80;
+    const char *name = xcbEventName(type);
+
+    attribute(name ? QStringLiteral("x11:") + QLatin1String(name)
+                   : QStringLiteral("x11:%1").arg(type), Specific);
+
+    return false;
+}
+
+QString WakeupMonitor::currentSource() const
+{
+    return m_priority == NoSource ? QStringLiteral("unknown") : m_source;
+}
+
+void WakeupMonitor::onAwake()
+{
+    if (m_awake)
+        return;
+
+    m_awake = true;
+    m_source.clear();
+    m_priority = NoSource;
+}
+
+void WakeupMonitor::onAboutToBlock()
+{
+    if (m_awake)
+        commit();
+}
+
+bool WakeupMonitor::wants(Priority priority) const
+{
+    return m_awake && priority > m_priority;
+}
+
+void WakeupMonitor::attribute(const QString &source, Priority priority)
+{
+    if (!wants(priority))
+        return;
+
+    m_source = source;
+    m_priority = priority;
+}
+
+void WakeupMonitor::commit()
+{
+    rotate();
+
+    ++m_minutes.first()[m_priority == NoSource ? QStringLiteral("unknown") : m_source];
+
+    m_awake = false;
+    m_priority = NoSource;
+}
+
+void WakeupMonitor::rotate()
+{
+    // Done lazily on the next wakeup, a timer would be a wakeup of its own.
+    const qint64 minute = m_clock.elapsed() / 60000;
+
+    if (minute == m_minute)
+        return;
+
+    if (m_logging)
+        qDebug().noquote() << "StatusBar:" << report(1);
+
+    const qint64 passed = qMin<qint64>(minute - m_minute, s_keptMinutes);
+    for (qint64 i = 0; i < passed; ++i)
+        m_minutes.prepend(QHash<QString, quint32>());
+
+    while (m_minutes.size() > s_keptMinutes)
+        m_minutes.removeLast();
+
+    m_minute = minute;
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2021 CutefishOS Team.
+ *
+ * Author:     cutefishos <cutefishos@foxmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WAKEUPMONITOR_H
+#define WAKEUPMONITOR_H
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QVariantMap>
+#include <QElapsedTimer>
+#include <QAbstractNativeEventFilter>
+
+/**
+ * Attributes event loop wakeups to whatever woke us up.
+ *
+ * Every time the event dispatcher wakes, the first event we can classify
+ * decides the source: timers by their owner, X events by type, DBus
+ * messages by sender and member (reported by the code handling them).
+ * Counts are kept per minute for the last hour.
+ *
+ * Off unless CUTEFISH_STATUSBAR_WAKEUPS is set or it is enabled over DBus,
+ * the event filters are only installed while it is on.
+ */
+class WakeupMonitor : public QObject, public QAbstractNativeEventFilter
+{
+    Q_OBJECT
+
+public:
+    static WakeupMonitor *self();
+    explicit WakeupMonitor(QObject *parent = nullptr);
+
+    bool enabled() const;
+    void setEnabled(bool enabled);
+
+    // Called from DBus signal and reply handlers.
+    static void dbusMessage(const QString &service, const QString &member);
+
+    // Wakeups per source summed over the last minutes.
+    QVariantMap counts(int minutes) const;
+    QString report(int minutes) const;
+
+    // What woke the event loop for the work being done right now.
+    QString currentSource() const;
+
+    bool eventFilter(QObject *watched, QEvent *event) override;
+    bool nativeEventFilter(const QByteArray &eventType, void *message, qintptr *result) override;
+
+private slots:
+    void onAwake();
+    void onAboutToBlock();
+
+private:
+    enum Priority {
+        NoSource = 0,
+        Generic,
+        Specific
+    };
+
+    // Whether a source of the given priority would still be taken.
+    bool wants(Priority priority) const;
+    void attribute(const QString &source, Priority priority);
+    void commit();
+    void rotate();
+
+private:
+    QElapsedTimer m_clock;
+    qint64 m_minute;
+
+    // Index 0 is the current minute.
+    QList<QHash<QString, quint32>> m_minutes;
+
+    bool m_enabled;
+    bool m_awake;
+    QString m_source;
+    Priority m_priority;
+    bool m_logging;
+};
+
+#endif // WAKEUPMONITOR_H
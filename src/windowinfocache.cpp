@@ -0,0 +1,282 @@
+/*
+ * Copyright (C) 2021 CutefishOS Team.
+ *
+ * Author:     cutefishos <cutefishos@foxmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "windowinfocache.h"
+#include "stallwatchdog.h"
+#include "tracer.h"
+
+#include <QGuiApplication>
+#include <QDebug>
+
+#include <KWindowInfo>
+#include <KWindowSystem>
+#include <KX11Extras>
+
+#include <xcb/xcb.h>
+#include <xcb/xproto.h>
+
+static WindowInfoCache *SELF = nullptr;
+
+// Upper bound for windows we keep around, unmanaged ones included.
+static const int s_maxEntries = 256;
+
+static const NET::Properties s_netProperties = NET::WMWindowType | NET::WMState | NET::WMVisibleName
+                                               | NET::WMName | NET::WMDesktop | NET::WMPid;
+static const NET::Properties2 s_netProperties2 = NET::WM2TransientFor | NET::WM2WindowClass;
+
+static xcb_connection_t *x11Connection()
+{
+    auto x11 = qApp->nativeInterface<QNativeInterface::QX11Application>();
+    return x11 ? x11->connection() : nullptr;
+}
+
+static xcb_atom_t internAtom(xcb_connection_t *c, const QByteArray &name)
+{
+    xcb_intern_atom_cookie_t cookie = xcb_intern_atom(c, false, name.size(), name.constData());
+    xcb_intern_atom_reply_t *reply = xcb_intern_atom_reply(c, cookie, nullptr);
+
+    if (!reply)
+        return XCB_ATOM_NONE;
+
+    xcb_atom_t atom = reply->atom;
+    free(reply);
+    return atom;
+}
+
+static QString propertyString(xcb_connection_t *c, xcb_get_property_cookie_t cookie)
+{
+    xcb_get_property_reply_t *reply = xcb_get_property_reply(c, cookie, nullptr);
+    QString value;
+
+    if (!reply)
+        return value;
+
+    if (reply->type == XCB_ATOM_STRING && reply->format == 8 && reply->value_len > 0) {
+        const char *data = reinterpret_cast<const char *>(xcb_get_property_value(reply));
+        int len = reply->value_len;
+        if (data)
+            value = QString::fromUtf8(data, data[len - 1] ? len : len - 1);
+    }
+
+    free(reply);
+    return value;
+}
+
+WindowInfoCache *WindowInfoCache::self()
+{
+    if (!SELF)
+        SELF = new WindowInfoCache;
+
+    return SELF;
+}
+
+WindowInfoCache::WindowInfoCache(QObject *parent)
+    : QObject(parent)
+    , m_serviceNameAtom(XCB_ATOM_NONE)
+    , m_objectPathAtom(XCB_ATOM_NONE)
+    , m_requests(0)
+    , m_roundTrips(0)
+{
+    m_statisticsClock.start();
+
+    if (!KWindowSystem::isPlatformX11())
+        return;
+
+    if (xcb_connection_t *c = x11Connection()) {
+        m_serviceNameAtom = internAtom(c, QByteArrayLiteral("_KDE_NET_WM_APPMENU_SERVICE_NAME"));
+        m_objectPathAtom = internAtom(c, QByteArrayLiteral("_KDE_NET_WM_APPMENU_OBJECT_PATH"));
+    }
+
+    // Connecting to windowChanged makes KX11Extras select PropertyChange
+    // on every client window, which also feeds our native event filter.
+    connect(KX11Extras::self(),
+            static_cast<void (KX11Extras::*)(WId, NET::Properties, NET::Properties2)>
+            (&KX11Extras::windowChanged),
+            this, &WindowInfoCache::onWindowChanged);
+    connect(KX11Extras::self(), &KX11Extras::windowAdded, this, &WindowInfoCache::onWindowRemoved);
+    connect(KX11Extras::self(), &KX11Extras::windowRemoved, this, &WindowInfoCache::onWindowRemoved);
+
+    qApp->installNativeEventFilter(this);
+
+    if (qEnvironmentVariableIsSet("CUTEFISH_STATUSBAR_X11_STATS")) {
+        connect(&m_statisticsTimer, &QTimer::timeout, this, &WindowInfoCache::updateStatistics);
+        m_statisticsTimer.start(10 * 1000);
+    }
+}
+
+WindowInfoCache::~WindowInfoCache()
+{
+    qApp->removeNativeEventFilter(this);
+}
+
+WindowInfo WindowInfoCache::info(WId id)
+{
+    // Every call used to be at least one synchronous X request.
+    ++m_requests;
+
+    if (!id)
+        return WindowInfo();
+
+    if (m_entries.size() >= s_maxEntries && !m_entries.contains(id))
+        m_entries.clear();
+
+    Entry &entry = m_entries[id];
+
+    if (!entry.netValid) {
+        fetchNetInfo(id, entry.info);
+        entry.netValid = true;
+    }
+
+    if (!entry.appMenuValid) {
+        fetchAppMenu(id, entry.info);
+        entry.appMenuValid = true;
+    }
+
+    return entry.info;
+}
+
+void WindowInfoCache::setAppMenu(WId id, const QString &serviceName, const QString &objectPath)
+{
+    auto it = m_entries.find(id);
+    if (it == m_entries.end())
+        return;
+
+    it->info.appMenuServiceName = serviceName;
+    it->info.appMenuObjectPath = objectPath;
+    it->appMenuValid = true;
+
+    emit windowChanged(id);
+}
+
+qreal WindowInfoCache::requestsPerSecond() const
+{
+    const qint64 elapsed = qMax<qint64>(m_statisticsClock.elapsed(), 1);
+    return m_requests * 1000.0 / elapsed;
+}
+
+qreal WindowInfoCache::roundTripsPerSecond() const
+{
+    const qint64 elapsed = qMax<qint64>(m_statisticsClock.elapsed(), 1);
+    return m_roundTrips * 1000.0 / elapsed;
+}
+
+bool WindowInfoCache::nativeEventFilter(const QByteArray &eventType, void *message, qintptr *result)
+{
+    Q_UNUSED(result)
+
+    if (eventType != "xcb_generic_event_t")
+        return false;
+
+    auto *event = static_cast<xcb_generic_event_t *>(message);
+
+    switch (event->response_type & ~0x80) {
+    case XCB_PROPERTY_NOTIFY: {
+        auto *e = reinterpret_cast<xcb_property_notify_event_t *>(event);
+
+        if (e->atom == XCB_ATOM_NONE || (e->atom != m_serviceNameAtom && e->atom != m_objectPathAtom))
+            break;
+
+        auto it = m_entries.find(e->window);
+        if (it != m_entries.end() && it->appMenuValid) {
+            it->appMenuValid = false;
+            emit windowChanged(e->window);
+        }
+        break;
+    }
+    case XCB_DESTROY_NOTIFY: {
+        auto *e = reinterpret_cast<xcb_destroy_notify_event_t *>(event);
+        m_entries.remove(e->window);
+        break;
+    }
+    default:
+        break;
+    }
+
+    return false;
+}
+
+void WindowInfoCache::onWindowChanged(WId id, NET::Properties properties, NET::Properties2 properties2)
+{
+    auto it = m_entries.find(id);
+    if (it == m_entries.end())
+        return;
+
+    if ((properties & s_netProperties) || (properties2 & s_netProperties2))
+        it->netValid = false;
+}
+
+void WindowInfoCache::onWindowRemoved(WId id)
+{
+    m_entries.remove(id);
+}
+
+void WindowInfoCache::updateStatistics()
+{
+    qDebug() << "WindowInfoCache: X requests/s asked" << requestsPerSecond()
+             << "issued" << roundTripsPerSecond();
+
+    m_requests = 0;
+    m_roundTrips = 0;
+    m_statisticsClock.restart();
+}
+
+void WindowInfoCache::fetchNetInfo(WId id, WindowInfo &info)
+{
+    if (!KWindowSystem::isPlatformX11())
+        return;
+
+    ++m_roundTrips;
+
+    BlockingSection section("x11", QStringLiteral("KWindowInfo"));
+    TraceSpan span("x11", "KWindowInfo", [&] { return QVariantMap {{"window", qulonglong(id)}}; });
+    KWindowInfo kinfo(id, s_netProperties, s_netProperties2);
+
+    info.valid = kinfo.valid();
+    if (!info.valid)
+        return;
+
+    info.windowType = kinfo.windowType(NET::AllTypesMask);
+    info.state = kinfo.state();
+    info.desktop = kinfo.desktop();
+    info.pid = kinfo.pid();
+    info.transientFor = kinfo.transientFor();
+    info.windowClassClass = kinfo.windowClassClass();
+    info.visibleName = kinfo.visibleName();
+}
+
+void WindowInfoCache::fetchAppMenu(WId id, WindowInfo &info)
+{
+    xcb_connection_t *c = x11Connection();
+
+    if (!c || m_serviceNameAtom == XCB_ATOM_NONE || m_objectPathAtom == XCB_ATOM_NONE)
+        return;
+
+    ++m_roundTrips;
+
+    BlockingSection section("x11", QStringLiteral("GetProperty appmenu"));
+    TraceSpan span("x11", "GetProperty appmenu", [&] { return QVariantMap {{"window", qulonglong(id)}}; });
+    static const uint32_t MAX_PROP_SIZE = 10000;
+    xcb_get_property_cookie_t serviceCookie =
+            xcb_get_property(c, false, id, m_serviceNameAtom, XCB_ATOM_STRING, 0, MAX_PROP_SIZE);
+    xcb_get_property_cookie_t pathCookie =
+            xcb_get_property(c, false, id, m_objectPathAtom, XCB_ATOM_STRING, 0, MAX_PROP_SIZE);
+
+    info.appMenuServiceName = propertyString(c, serviceCookie);
+    info.appMenuObjectPath = propertyString(c, pathCookie);
+}
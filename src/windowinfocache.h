@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2021 CutefishOS Team.
+ *
+ * Author:     cutefishos <cutefishos@foxmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WINDOWINFOCACHE_H
+#define WINDOWINFOCACHE_H
+
+#include <QObject>
+#include <QHash>
+#include <QTimer>
+#include <QAbstractNativeEventFilter>
+#include <QElapsedTimer>
+
+#include <NETWM>
+
+class WindowInfo
+{
+public:
+    bool valid = false;
+    NET::WindowType windowType = NET::Unknown;
+    NET::States state;
+    int desktop = 0;
+    int pid = 0;
+    WId transientFor = 0;
+    QByteArray windowClassClass;
+    QString visibleName;
+
+    QString appMenuServiceName;
+    QString appMenuObjectPath;
+
+    bool hasState(NET::States s) const { return (state & s) == s; }
+};
+
+/**
+ * Per-window X11 properties shared by Activity, AppMenuModel and MenuImporter.
+ *
+ * Entries are fetched once and then kept current from the NETWM change
+ * notifications and PropertyNotify events for the appmenu atoms, so repeated
+ * queries for the same window do not go to the X server.
+ */
+class WindowInfoCache : public QObject, public QAbstractNativeEventFilter
+{
+    Q_OBJECT
+
+public:
+    static WindowInfoCache *self();
+    explicit WindowInfoCache(QObject *parent = nullptr);
+    ~WindowInfoCache();
+
+    WindowInfo info(WId id);
+
+    // Set by AppMenu when it exports the registrar data onto a window.
+    void setAppMenu(WId id, const QString &serviceName, const QString &objectPath);
+
+    // X round trips per second: what the callers used to issue and what the cache issues.
+    qreal requestsPerSecond() const;
+    qreal roundTripsPerSecond() const;
+
+    bool nativeEventFilter(const QByteArray &eventType, void *message, qintptr *result) override;
+
+signals:
+    void windowChanged(WId id);
+
+private slots:
+    void onWindowChanged(WId id, NET::Properties properties, NET::Properties2 properties2);
+    void onWindowRemoved(WId id);
+    void updateStatistics();
+
+private:
+    void fetchNetInfo(WId id, WindowInfo &info);
+    void fetchAppMenu(WId id, WindowInfo &info);
+
+    struct Entry {
+        WindowInfo info;
+        bool netValid = false;
+        bool appMenuValid = false;
+    };
+
+    QHash<WId, Entry> m_entries;
+
+    quint32 m_serviceNameAtom;
+    quint32 m_objectPathAtom;
+
+    quint64 m_requests;
+    quint64 m_roundTrips;
+    QElapsedTimer m_statisticsClock;
+    QTimer m_statisticsTimer;
+};
+
+#endif // WINDOWINFOCACHE_H
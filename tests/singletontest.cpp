@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2021 CutefishOS Team.
+ *
+ * Author:     cutefishos <cutefishos@foxmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QtTest>
+#include <QApplication>
+#include <QDBusConnection>
+#include <QQmlEngine>
+
+// Generated by qt_add_qml_module for the backing library.
+extern void qml_register_types_Cutefish_StatusBar();
+
+static const char *s_uri = "Cutefish.StatusBar";
+
+// Backends that talk to a DBus service.
+static const QStringList s_backends = {
+    QStringLiteral("Appearance"),
+    QStringLiteral("Battery"),
+    QStringLiteral("Brightness"),
+    QStringLiteral("EcoMode"),
+    QStringLiteral("Notifications"),
+    QStringLiteral("PowerActions"),
+};
+
+// Every backend is one C++ instance no matter how often or from which
+// engine QML resolves it.
+class SingletonTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+
+    void sameInstance_data();
+    void sameInstance();
+
+private:
+    QObject *resolve(QQmlEngine &engine, const QString &name);
+};
+
+void SingletonTest::initTestCase()
+{
+    // ctest runs us under dbus-run-session, never touch the user's bus.
+    QVERIFY(QDBusConnection::sessionBus().isConnected());
+
+    qml_register_types_Cutefish_StatusBar();
+}
+
+QObject *SingletonTest::resolve(QQmlEngine &engine, const QString &name)
+{
+    const int typeId = qmlTypeId(s_uri, 1, 0, name.toUtf8().constData());
+    if (typeId < 0)
+        return nullptr;
+
+    return engine.singletonInstance<QObject *>(typeId);
+}
+
+void SingletonTest::sameInstance_data()
+{
+    QTest::addColumn<QString>("name");
+
+    for (const QString &name : s_backends)
+        QTest::newRow(name.toUtf8().constData()) << name;
+}
+
+void SingletonTest::sameInstance()
+{
+    QFETCH(QString, name);
+
+    QQmlEngine engine;
+    QQmlEngine otherEngine;
+
+    QObject *first = resolve(engine, name);
+    QVERIFY2(first, qPrintable(name + " is not a registered singleton"));
+
+    QCOMPARE(resolve(engine, name), first);
+    QCOMPARE(resolve(otherEngine, name), first);
+}
+
+QTEST_MAIN(SingletonTest)
+
+#include "singletontest.moc"